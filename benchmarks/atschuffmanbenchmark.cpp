@@ -0,0 +1,97 @@
+/*
+ * atschuffmanbenchmark.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QTest>
+#include "dvbsi.h"
+
+class AtscHuffmanBenchmark : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void compare();
+	void convertText_data();
+	void convertText();
+
+private:
+	QList<QByteArray> strings;
+};
+
+void AtscHuffmanBenchmark::initTestCase()
+{
+	// every bit sequence is a valid input, so pseudo-random strings can be used
+	quint32 value = 1;
+
+	for (int i = 0; i < 1000; ++i) {
+		QByteArray string;
+		value = ((value * 1103515245) + 12345);
+		string.resize((value >> 16) & 0xff);
+
+		for (int j = 0; j < string.size(); ++j) {
+			value = ((value * 1103515245) + 12345);
+			string[j] = char(value >> 16);
+		}
+
+		strings.append(string);
+	}
+}
+
+void AtscHuffmanBenchmark::compare()
+{
+	for (int table = 1; table <= 2; ++table) {
+		foreach (const QByteArray &string, strings) {
+			QCOMPARE(AtscHuffmanString::convertText(string.constData(), string.size(), table),
+				AtscHuffmanString::convertTextBitwise(string.constData(), string.size(),
+				table));
+		}
+	}
+}
+
+void AtscHuffmanBenchmark::convertText_data()
+{
+	QTest::addColumn<int>("table");
+	QTest::addColumn<bool>("bitwise");
+
+	QTest::newRow("table1/bitwise") << 1 << true;
+	QTest::newRow("table1/lookup") << 1 << false;
+	QTest::newRow("table2/bitwise") << 2 << true;
+	QTest::newRow("table2/lookup") << 2 << false;
+}
+
+void AtscHuffmanBenchmark::convertText()
+{
+	QFETCH(int, table);
+	QFETCH(bool, bitwise);
+
+	QBENCHMARK {
+		foreach (const QByteArray &string, strings) {
+			if (bitwise) {
+				AtscHuffmanString::convertTextBitwise(string.constData(), string.size(),
+					table);
+			} else {
+				AtscHuffmanString::convertText(string.constData(), string.size(), table);
+			}
+		}
+	}
+}
+
+QTEST_GUILESS_MAIN(AtscHuffmanBenchmark)
+
+#include "atschuffmanbenchmark.moc"
@@ -0,0 +1,106 @@
+/*
+ * benchmarkfixture.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "benchmarkfixture.h"
+
+#include <QFile>
+#include <QtDebug>
+
+QString BenchmarkFixture::filePath(const QString &fileName)
+{
+	return (QLatin1String(KAFFEINE_BENCHMARK_FIXTURES "/") + fileName);
+}
+
+QByteArray BenchmarkFixture::readFile(const QString &fileName)
+{
+	QFile file(filePath(fileName));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		qWarning() << "BenchmarkFixture::readFile: cannot open" << file.fileName();
+		return QByteArray();
+	}
+
+	return file.readAll();
+}
+
+// a simple reassembler, independent of DvbSectionFilterInternal (which is measured)
+
+QList<QByteArray> BenchmarkFixture::extractSections(const QByteArray &stream, int pid)
+{
+	QList<QByteArray> sections;
+	QByteArray buffer;
+	bool synchronized = false;
+
+	for (int i = 0; (i + 188) <= stream.size(); i += 188) {
+		const unsigned char *packet =
+			reinterpret_cast<const unsigned char *>(stream.constData() + i);
+
+		if ((packet[0] != 0x47) || ((((packet[1] << 8) | packet[2]) & 0x1fff) != pid) ||
+		    ((packet[3] & 0x10) == 0)) {
+			continue;
+		}
+
+		int payloadStart = 4;
+
+		if ((packet[3] & 0x20) != 0) {
+			payloadStart += (packet[4] + 1);
+		}
+
+		if ((packet[1] & 0x40) != 0) {
+			if (payloadStart >= 188) {
+				continue;
+			}
+
+			int pointer = packet[payloadStart];
+			++payloadStart;
+
+			if (!synchronized) {
+				payloadStart += pointer;
+				synchronized = true;
+			}
+		}
+
+		if (!synchronized || (payloadStart >= 188)) {
+			continue;
+		}
+
+		buffer.append(reinterpret_cast<const char *>(packet) + payloadStart,
+			188 - payloadStart);
+
+		while ((buffer.size() >= 3) && (quint8(buffer.at(0)) != 0xff)) {
+			int size = ((((quint8(buffer.at(1)) & 0x0f) << 8) | quint8(buffer.at(2))) + 3);
+
+			if (size > buffer.size()) {
+				break;
+			}
+
+			sections.append(buffer.left(size));
+			buffer.remove(0, size);
+		}
+
+		if ((buffer.size() > 0) && (quint8(buffer.at(0)) == 0xff)) {
+			// stuffing; the next section starts in a new packet
+			buffer.clear();
+			synchronized = false;
+		}
+	}
+
+	return sections;
+}
@@ -0,0 +1,46 @@
+/*
+ * benchmarkfixture.h
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef BENCHMARKFIXTURE_H
+#define BENCHMARKFIXTURE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// access to the transport streams in benchmarks/fixtures (see the README there)
+
+class BenchmarkFixture
+{
+public:
+	static QString filePath(const QString &fileName);
+
+	// returns an empty array (and prints a warning) if the file cannot be read
+	static QByteArray readFile(const QString &fileName);
+
+	// the complete sections of a pid (in stream order, including repetitions)
+	static QList<QByteArray> extractSections(const QByteArray &stream, int pid);
+
+private:
+	BenchmarkFixture();
+	~BenchmarkFixture();
+};
+
+#endif /* BENCHMARKFIXTURE_H */
@@ -0,0 +1,92 @@
+/*
+ * crcbenchmark.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QTest>
+#include "dvbcrc.h"
+
+Q_DECLARE_METATYPE(DvbCrc32::Implementation)
+
+class CrcBenchmark : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void crc32_data();
+	void crc32();
+
+private:
+	QByteArray data;
+};
+
+void CrcBenchmark::initTestCase()
+{
+	// pseudo-random content (the largest possible private section)
+	data.resize(4096);
+	quint32 value = 1;
+
+	for (int i = 0; i < data.size(); ++i) {
+		value = ((value * 1103515245) + 12345);
+		data[i] = char(value >> 16);
+	}
+}
+
+void CrcBenchmark::crc32_data()
+{
+	QTest::addColumn<DvbCrc32::Implementation>("implementation");
+	QTest::addColumn<int>("size");
+
+	// typical sizes: short psi section, eit section, maximum private section
+	static const int sizes[] = { 32, 1024, 4096 };
+
+	for (int i = 0; i < DvbCrc32::ImplementationCount; ++i) {
+		DvbCrc32::Implementation implementation = DvbCrc32::Implementation(i);
+
+		if (!DvbCrc32::isSupported(implementation)) {
+			continue;
+		}
+
+		for (unsigned int j = 0; j < (sizeof(sizes) / sizeof(sizes[0])); ++j) {
+			QByteArray name = DvbCrc32::implementationName(implementation);
+			name += '/';
+			name += QByteArray::number(sizes[j]);
+			QTest::newRow(name.constData()) << implementation << sizes[j];
+		}
+	}
+}
+
+void CrcBenchmark::crc32()
+{
+	QFETCH(DvbCrc32::Implementation, implementation);
+	QFETCH(int, size);
+
+	quint32 expected = DvbCrc32::update(DvbCrc32::Bytewise, 0xffffffff, data.constData(), size);
+	QCOMPARE(DvbCrc32::update(implementation, 0xffffffff, data.constData(), size), expected);
+	quint32 crc = 0;
+
+	QBENCHMARK {
+		crc ^= DvbCrc32::update(implementation, 0xffffffff, data.constData(), size);
+	}
+
+	Q_UNUSED(crc)
+}
+
+QTEST_GUILESS_MAIN(CrcBenchmark)
+
+#include "crcbenchmark.moc"
@@ -0,0 +1,461 @@
+/*
+ * devicebenchmark.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <KActionCollection>
+#include <KToolBar>
+#include <QApplication>
+#include <QFile>
+#include <QMenu>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVector>
+#include <cstring>
+#include "../src/mediawidget.h"
+#include "../src/sqlhelper.h"
+#include "benchmarkfixture.h"
+#include "dvbcrc.h"
+#include "dvbdevice.h"
+#include "dvbdevice_file.h"
+#include "dvbepg.h"
+#include "dvbmanager.h"
+#include "dvbsi.h"
+
+// a backend without hardware; the benchmark writes the data itself
+
+class BenchmarkBackend : public DvbBackendDevice
+{
+public:
+	BenchmarkBackend() : frontend(NULL) { }
+	~BenchmarkBackend() { }
+
+	DvbFrontendDevice *frontend;
+
+protected:
+	QString getDeviceId() { return QLatin1String("B0"); }
+	QString getFrontendName() { return QLatin1String("Benchmark"); }
+	TransmissionTypes getTransmissionTypes() { return DvbT; }
+	Capabilities getCapabilities() { return Capabilities(); }
+	void setFrontendDevice(DvbFrontendDevice *frontend_) { frontend = frontend_; }
+	void setDeviceEnabled(bool enabled) { Q_UNUSED(enabled) }
+	bool acquire() { return true; }
+	bool setTone(SecTone tone) { Q_UNUSED(tone) return true; }
+	bool setVoltage(SecVoltage voltage) { Q_UNUSED(voltage) return true; }
+	bool sendMessage(const char *message, int length)
+	{
+		Q_UNUSED(message)
+		Q_UNUSED(length)
+		return true;
+	}
+
+	bool sendBurst(SecBurst burst) { Q_UNUSED(burst) return true; }
+	bool tune(const DvbTransponder &transponder) { Q_UNUSED(transponder) return true; }
+	bool isTuned() { return true; }
+	int getSignal() { return -1; }
+	int getSnr() { return -1; }
+	int getSyncLossCount() { return 0; }
+	int getTransportErrorCount() { return 0; }
+	qint64 getSkippedBytes() { return 0; }
+	bool addPidFilter(int pid) { Q_UNUSED(pid) return true; }
+	void removePidFilter(int pid) { Q_UNUSED(pid) }
+	void startDescrambling(const QByteArray &pmtSectionData) { Q_UNUSED(pmtSectionData) }
+	void stopDescrambling(int serviceId) { Q_UNUSED(serviceId) }
+	void release() { }
+};
+
+class BenchmarkSectionFilter : public DvbSectionFilter
+{
+public:
+	explicit BenchmarkSectionFilter(bool changesOnly_) : changesOnly(changesOnly_), count(0) { }
+	~BenchmarkSectionFilter() { }
+
+	bool isChangesOnly() const
+	{
+		return changesOnly;
+	}
+
+	void processSection(const char *data, int size)
+	{
+		Q_UNUSED(data)
+		Q_UNUSED(size)
+		++count;
+	}
+
+	bool changesOnly;
+	int count;
+};
+
+class ReplaySectionFilter : public DvbSectionFilter
+{
+public:
+	ReplaySectionFilter() { }
+	~ReplaySectionFilter() { }
+
+	void processSection(const char *data, int size)
+	{
+		sections.append(QByteArray(data, size));
+	}
+
+	QList<QByteArray> sections;
+};
+
+class DeviceBenchmark : public QObject
+{
+	Q_OBJECT
+public:
+	DeviceBenchmark() : menu(NULL), toolBar(NULL), collection(NULL), mediaWidget(NULL),
+		manager(NULL) { }
+	~DeviceBenchmark() { }
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void processSections_data();
+	void processSections();
+	void addEntry_data();
+	void addEntry();
+	void replayFile();
+
+public slots:
+	void fileDeviceAdded(DvbBackendDevice *device);
+
+private:
+	QByteArray stream;
+	QByteArray endPacket; // marks the end of the stream for the benchmark
+	QList<DvbEpgEntry> epgEntries;
+	QMenu *menu;
+	KToolBar *toolBar;
+	KActionCollection *collection;
+	MediaWidget *mediaWidget;
+	DvbManager *manager;
+	QList<DvbBackendDevice *> fileDevices;
+};
+
+void DeviceBenchmark::initTestCase()
+{
+	// don't touch the user's configuration, channels or epg data
+	QStandardPaths::setTestModeEnabled(true);
+	// the epg data of a previous run mustn't change the workload
+	QFile::remove(QStandardPaths::writableLocation(QStandardPaths::DataLocation) +
+		QLatin1String("/epgdata.dvb"));
+
+	stream = BenchmarkFixture::readFile(QLatin1String("dvbt-si.ts"));
+	QVERIFY(!stream.isEmpty() && ((stream.size() % 188) == 0));
+
+	// a private section (table id 0x80) on pid 0x1ffe
+	endPacket.fill(char(0xff), 188);
+	const char header[] = { 0x47, 0x5f, char(0xfe), 0x10, 0x00, char(0x80), 0x70, 0x04 };
+	memcpy(endPacket.data(), header, sizeof(header));
+	quint32 crc32 = DvbCrc32::compute(endPacket.constData() + 5, 3);
+	endPacket[8] = char(crc32 >> 24);
+	endPacket[9] = char(crc32 >> 16);
+	endPacket[10] = char(crc32 >> 8);
+	endPacket[11] = char(crc32);
+
+	// epg entries like DvbEpgFilter creates them (shifted into the future)
+
+	QList<QByteArray> eitSections = BenchmarkFixture::extractSections(stream, 0x12);
+	QVERIFY(!eitSections.isEmpty());
+	QMap<int, DvbSharedChannel> channels;
+	QDateTime firstBegin;
+
+	foreach (const QByteArray &data, eitSections) {
+		DvbEitSection eitSection(data);
+		QVERIFY(eitSection.isValid());
+		DvbSharedChannel channel = channels.value(eitSection.serviceId());
+
+		if (!channel.isValid()) {
+			DvbChannel *newChannel = new DvbChannel();
+			newChannel->name = QString::number(eitSection.serviceId());
+			newChannel->networkId = eitSection.originalNetworkId();
+			newChannel->transportStreamId = eitSection.transportStreamId();
+			newChannel->serviceId = eitSection.serviceId();
+			channel = DvbSharedChannel(newChannel);
+			channels.insert(eitSection.serviceId(), channel);
+		}
+
+		for (DvbEitSectionEntry entry = eitSection.entries(); entry.isValid();
+		     entry.advance()) {
+			DvbEpgEntry epgEntry;
+			epgEntry.channel = channel;
+			int startTime = entry.startTime();
+			int duration = entry.duration();
+			epgEntry.begin = QDateTime(QDate::fromJulianDay(entry.startDate() + 2400001),
+				QTime(DvbDescriptor::bcdToInt(startTime >> 16, 1),
+				DvbDescriptor::bcdToInt((startTime >> 8) & 0xff, 1),
+				DvbDescriptor::bcdToInt(startTime & 0xff, 1)), Qt::UTC);
+			epgEntry.duration = QTime(DvbDescriptor::bcdToInt(duration >> 16, 1),
+				DvbDescriptor::bcdToInt((duration >> 8) & 0xff, 1),
+				DvbDescriptor::bcdToInt(duration & 0xff, 1));
+
+			if (!firstBegin.isValid() || (epgEntry.begin < firstBegin)) {
+				firstBegin = epgEntry.begin;
+			}
+
+			for (DvbDescriptor descriptor = entry.descriptors(); descriptor.isValid();
+			     descriptor.advance()) {
+				if (descriptor.descriptorTag() == 0x4d) {
+					DvbShortEventDescriptor eventDescriptor(descriptor);
+
+					if (eventDescriptor.isValid()) {
+						epgEntry.title = eventDescriptor.eventName();
+						epgEntry.subheading = eventDescriptor.text();
+					}
+				} else if (descriptor.descriptorTag() == 0x4e) {
+					DvbExtendedEventDescriptor eventDescriptor(descriptor);
+
+					if (eventDescriptor.isValid()) {
+						epgEntry.details += eventDescriptor.text();
+					}
+				}
+			}
+
+			epgEntries.append(epgEntry);
+		}
+	}
+
+	qint64 offset = firstBegin.secsTo(QDateTime::currentDateTimeUtc()) + 3600;
+
+	for (int i = 0; i < epgEntries.size(); ++i) {
+		epgEntries[i].begin = epgEntries.at(i).begin.addSecs(offset);
+	}
+
+	// the epg model belongs to the dvb manager, which needs a media widget
+	menu = new QMenu();
+	toolBar = new KToolBar(NULL);
+	collection = new KActionCollection(this);
+	mediaWidget = new MediaWidget(menu, toolBar, collection, NULL);
+	QVERIFY(SqlHelper::createInstance());
+	manager = new DvbManager(mediaWidget, NULL);
+}
+
+void DeviceBenchmark::cleanupTestCase()
+{
+	delete manager;
+	delete mediaWidget;
+	delete toolBar;
+	delete menu;
+}
+
+void DeviceBenchmark::processSections_data()
+{
+	QTest::addColumn<bool>("demuxThread");
+	QTest::addColumn<bool>("changesOnly");
+
+	// with demux thread the sections reach the filters via DvbDevice::customEvent()
+	QTest::newRow("main thread/all sections") << false << false;
+	QTest::newRow("main thread/changes only") << false << true;
+	QTest::newRow("demux thread/all sections") << true << false;
+	QTest::newRow("demux thread/changes only") << true << true;
+}
+
+// reassembly, crc check and dispatch of all sections in the fixture
+
+void DeviceBenchmark::processSections()
+{
+	QFETCH(bool, demuxThread);
+	QFETCH(bool, changesOnly);
+
+	BenchmarkBackend backend;
+	DvbDevice *device = new DvbDevice(&backend, NULL);
+	device->setDemuxThreadEnabled(demuxThread);
+	QVERIFY(backend.frontend != NULL);
+
+	QList<int> pids;
+	pids << 0x00 << 0x11 << 0x12;
+
+	for (int i = 0x100; i < 0x180; i += 0x10) {
+		pids.append(i);
+	}
+
+	BenchmarkSectionFilter sectionFilter(changesOnly);
+	BenchmarkSectionFilter endFilter(false);
+
+	foreach (int pid, pids) {
+		QVERIFY(backend.frontend->addSectionFilter(pid, &sectionFilter));
+	}
+
+	QVERIFY(backend.frontend->addSectionFilter(0x1ffe, &endFilter));
+	QByteArray data = (stream + endPacket);
+	QVector<unsigned char> continuityCounters(8192, 0);
+
+	QBENCHMARK {
+		int endCount = endFilter.count;
+		int position = 0;
+
+		while (position < data.size()) {
+			DvbDataBuffer buffer = backend.frontend->getBuffer();
+			buffer.dataSize = qMin(buffer.bufferSize, data.size() - position);
+			memcpy(buffer.data, data.constData() + position, buffer.dataSize);
+
+			// the continuity counters have to continue across iterations, otherwise
+			// packets are dropped as duplicates
+			for (int i = 0; i < buffer.dataSize; i += 188) {
+				char *packet = (buffer.data + i);
+				int pid = (((quint8(packet[1]) << 8) | quint8(packet[2])) & 0x1fff);
+				packet[3] = char((packet[3] & 0xf0) | continuityCounters.at(pid));
+				continuityCounters[pid] = ((continuityCounters.at(pid) + 1) & 0x0f);
+			}
+
+			backend.frontend->writeBuffer(buffer);
+			position += buffer.dataSize;
+		}
+
+		while (endFilter.count == endCount) {
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		}
+	}
+
+	QVERIFY(sectionFilter.count > 0);
+
+	foreach (int pid, pids) {
+		backend.frontend->removeSectionFilter(pid, &sectionFilter);
+	}
+
+	backend.frontend->removeSectionFilter(0x1ffe, &endFilter);
+	delete device;
+}
+
+void DeviceBenchmark::addEntry_data()
+{
+	QTest::addColumn<bool>("newEntries");
+
+	// most eit sections are repetitions of known events
+	QTest::newRow("existing entries") << false;
+	QTest::newRow("new entries") << true;
+}
+
+void DeviceBenchmark::addEntry()
+{
+	QFETCH(bool, newEntries);
+
+	if (!newEntries) {
+		DvbEpgModel *epgModel = manager->getEpgModel();
+
+		foreach (const DvbEpgEntry &entry, epgEntries) {
+			QVERIFY(epgModel->addEntry(entry).isValid());
+		}
+
+		QBENCHMARK {
+			foreach (const DvbEpgEntry &entry, epgEntries) {
+				epgModel->addEntry(entry);
+			}
+		}
+
+		return;
+	}
+
+	// new entries make the model grow, so every iteration would measure a different
+	// workload; instead a fresh model with the known entries gets a fixed set of new
+	// entries (the following eight weeks) once
+	DvbEpgModel epgModel(manager, NULL);
+	QList<DvbEpgEntry> entries;
+
+	foreach (const DvbEpgEntry &entry, epgEntries) {
+		QVERIFY(epgModel.addEntry(entry).isValid());
+
+		for (int week = 1; week <= 8; ++week) {
+			DvbEpgEntry newEntry = entry;
+			newEntry.begin = entry.begin.addDays(7 * week);
+			entries.append(newEntry);
+		}
+	}
+
+	int count = epgModel.getEntries().size();
+
+	QBENCHMARK_ONCE {
+		foreach (const DvbEpgEntry &entry, entries) {
+			epgModel.addEntry(entry);
+		}
+	}
+
+	QVERIFY(epgModel.getEntries().size() > count);
+}
+
+// not a benchmark, but it makes sure that the virtual tuner (used for load tests) keeps working;
+// the fixture is replayed through DvbFileDeviceManager and DvbDevice as fast as possible
+
+void DeviceBenchmark::replayFile()
+{
+	QTemporaryDir folder;
+	QVERIFY(folder.isValid());
+	QFile index(folder.path() + QLatin1String("/transponders.txt"));
+	QVERIFY(index.open(QIODevice::WriteOnly));
+	QString line = (BenchmarkFixture::filePath(QLatin1String("dvbt-si.ts")) +
+		QLatin1String("\tT 578000000 8MHz 2/3 NONE QAM16 8k 1/4 NONE\n"));
+	QVERIFY(index.write(line.toUtf8()) > 0);
+	index.close();
+
+	fileDevices.clear();
+	DvbFileDeviceManager *deviceManager =
+		new DvbFileDeviceManager(NULL, folder.path(), 1, false);
+	connect(deviceManager, SIGNAL(deviceAdded(DvbBackendDevice*)),
+		this, SLOT(fileDeviceAdded(DvbBackendDevice*)));
+	deviceManager->doColdPlug();
+	QCOMPARE(fileDevices.size(), 1);
+
+	DvbBackendDevice *backend = fileDevices.at(0);
+	DvbDevice *device = new DvbDevice(backend, NULL);
+	QVERIFY((backend->getTransmissionTypes() & DvbBackendDevice::DvbT) != 0);
+
+	ReplaySectionFilter patFilter;
+	ReplaySectionFilter eitFilter;
+	QVERIFY(device->addSectionFilter(0x00, &patFilter));
+	QVERIFY(device->addSectionFilter(0x12, &eitFilter));
+
+	QVERIFY(backend->tune(DvbTransponder::fromString(
+		QLatin1String("T 578000000 8MHz 2/3 NONE QAM16 8k 1/4 NONE"))));
+	QVERIFY(backend->isTuned());
+	QTRY_VERIFY_WITH_TIMEOUT(!patFilter.sections.isEmpty() && !eitFilter.sections.isEmpty(),
+		10000);
+
+	// the sections have to arrive unchanged
+	DvbPatSection patSection(patFilter.sections.at(0));
+	QVERIFY(patSection.isValid());
+	QCOMPARE(patSection.transportStreamId(), 0x0401);
+	DvbEitSection eitSection(eitFilter.sections.at(0));
+	QVERIFY(eitSection.isValid());
+	QVERIFY(eitSection.entries().isValid());
+
+	device->removeSectionFilter(0x00, &patFilter);
+	device->removeSectionFilter(0x12, &eitFilter);
+	backend->release();
+	delete device;
+	delete deviceManager;
+}
+
+void DeviceBenchmark::fileDeviceAdded(DvbBackendDevice *device)
+{
+	fileDevices.append(device);
+}
+
+int main(int argc, char *argv[])
+{
+	// the media widget doesn't need a display
+	if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+
+	QApplication app(argc, argv);
+	DeviceBenchmark benchmark;
+	return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "devicebenchmark.moc"
@@ -0,0 +1,251 @@
+/*
+ * sibenchmark.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QTest>
+#include "benchmarkfixture.h"
+#include "dvbsi.h"
+
+class SiBenchmark : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void verifyCrc32();
+	void parseEit();
+	void convertText_data();
+	void convertText();
+	void generatePackets();
+	void updatePmt();
+
+private:
+	QList<QByteArray> sections; // all sections of the fixture
+	QList<QByteArray> eitSections;
+	QList<QByteArray> texts; // raw texts of the service and event descriptors
+	QByteArray pmtSection;
+	int transportStreamId;
+	int programNumber;
+	int pmtPid;
+};
+
+void SiBenchmark::initTestCase()
+{
+	QByteArray stream = BenchmarkFixture::readFile(QLatin1String("dvbt-si.ts"));
+	QVERIFY(!stream.isEmpty());
+
+	QList<QByteArray> patSections = BenchmarkFixture::extractSections(stream, 0x00);
+	QVERIFY(!patSections.isEmpty());
+	DvbPatSection patSection(patSections.at(0));
+	QVERIFY(patSection.isValid());
+	DvbPatSectionEntry patEntry = patSection.entries();
+	QVERIFY(patEntry.isValid());
+	transportStreamId = patSection.transportStreamId();
+	programNumber = patEntry.programNumber();
+	pmtPid = patEntry.pid();
+
+	QList<QByteArray> pmtSections = BenchmarkFixture::extractSections(stream, pmtPid);
+	QVERIFY(!pmtSections.isEmpty());
+	pmtSection = pmtSections.at(0);
+
+	QList<QByteArray> sdtSections = BenchmarkFixture::extractSections(stream, 0x11);
+	eitSections = BenchmarkFixture::extractSections(stream, 0x12);
+	QVERIFY(!sdtSections.isEmpty() && !eitSections.isEmpty());
+	sections << patSections << pmtSections << sdtSections << eitSections;
+
+	// collect the texts as they are passed to DvbSiText::convertText()
+
+	foreach (const QByteArray &data, sdtSections) {
+		DvbSdtSection sdtSection(data);
+
+		for (DvbSdtSectionEntry entry = sdtSection.entries(); entry.isValid();
+		     entry.advance()) {
+			for (DvbDescriptor descriptor = entry.descriptors(); descriptor.isValid();
+			     descriptor.advance()) {
+				const char *text = descriptor.getData();
+
+				if ((descriptor.descriptorTag() != 0x48) || (descriptor.getLength() < 4)) {
+					continue;
+				}
+
+				int providerNameLength = quint8(text[3]);
+				texts.append(QByteArray(text + 4, providerNameLength));
+				int serviceNameLength = quint8(text[4 + providerNameLength]);
+				texts.append(QByteArray(text + 5 + providerNameLength, serviceNameLength));
+			}
+		}
+	}
+
+	foreach (const QByteArray &data, eitSections) {
+		DvbEitSection eitSection(data);
+
+		for (DvbEitSectionEntry entry = eitSection.entries(); entry.isValid();
+		     entry.advance()) {
+			for (DvbDescriptor descriptor = entry.descriptors(); descriptor.isValid();
+			     descriptor.advance()) {
+				const char *text = descriptor.getData();
+
+				if ((descriptor.descriptorTag() == 0x4d) && (descriptor.getLength() >= 7)) {
+					int nameLength = quint8(text[5]);
+					texts.append(QByteArray(text + 6, nameLength));
+					int textLength = quint8(text[6 + nameLength]);
+					texts.append(QByteArray(text + 7 + nameLength, textLength));
+				} else if ((descriptor.descriptorTag() == 0x4e) &&
+					   (descriptor.getLength() >= 8)) {
+					int itemsLength = quint8(text[6]);
+					int textLength = quint8(text[7 + itemsLength]);
+					texts.append(QByteArray(text + 8 + itemsLength, textLength));
+				}
+			}
+		}
+	}
+}
+
+void SiBenchmark::verifyCrc32()
+{
+	foreach (const QByteArray &section, sections) {
+		QCOMPARE(DvbStandardSection::verifyCrc32(section.constData(), section.size()), 0);
+	}
+
+	int result = 0;
+
+	QBENCHMARK {
+		foreach (const QByteArray &section, sections) {
+			result |= DvbStandardSection::verifyCrc32(section.constData(), section.size());
+		}
+	}
+
+	QCOMPARE(result, 0);
+}
+
+// iterates over the eit entries and descriptors like DvbEpgFilter (without decoding texts)
+
+void SiBenchmark::parseEit()
+{
+	int count = 0;
+
+	QBENCHMARK {
+		foreach (const QByteArray &data, eitSections) {
+			DvbEitSection eitSection(data.constData(), data.size());
+
+			for (DvbEitSectionEntry entry = eitSection.entries(); entry.isValid();
+			     entry.advance()) {
+				count += (entry.startDate() + entry.startTime() + entry.duration());
+
+				for (DvbDescriptor descriptor = entry.descriptors(); descriptor.isValid();
+				     descriptor.advance()) {
+					count += descriptor.descriptorTag();
+				}
+			}
+		}
+	}
+
+	Q_UNUSED(count)
+}
+
+void SiBenchmark::convertText_data()
+{
+	QTest::addColumn<bool>("cached");
+
+	// the epg sees the same texts again and again (repetitions, current / next)
+	QTest::newRow("cached") << true;
+	QTest::newRow("uncached") << false;
+}
+
+void SiBenchmark::convertText()
+{
+	QFETCH(bool, cached);
+
+	// a cold decode has to give the same strings as a warm one
+	DvbSiText::clearCache();
+	QStringList coldTexts;
+
+	foreach (const QByteArray &text, texts) {
+		coldTexts.append(DvbSiText::convertText(text.constData(), text.size()));
+	}
+
+	for (int i = 0; i < texts.size(); ++i) {
+		const QByteArray &text = texts.at(i);
+		QCOMPARE(DvbSiText::convertText(text.constData(), text.size()), coldTexts.at(i));
+	}
+
+	QBENCHMARK {
+		if (!cached) {
+			DvbSiText::clearCache();
+		}
+
+		foreach (const QByteArray &text, texts) {
+			DvbSiText::convertText(text.constData(), text.size());
+		}
+	}
+}
+
+// the pat and pmt are inserted into the live stream and into recordings periodically
+
+void SiBenchmark::generatePackets()
+{
+	DvbPmtSection section(pmtSection);
+	QVERIFY(section.isValid());
+	QList<int> pids;
+
+	for (DvbPmtSectionEntry entry = section.entries(); entry.isValid(); entry.advance()) {
+		pids.append(entry.pid());
+	}
+
+	DvbSectionGenerator patGenerator;
+	DvbSectionGenerator pmtGenerator;
+	patGenerator.initPat(transportStreamId, programNumber, pmtPid);
+	pmtGenerator.initPmt(pmtPid, section, pids);
+	int size = 0;
+
+	QBENCHMARK {
+		// like DvbRecordingFile::insertPatPmt(); the packets aren't copied
+		size += patGenerator.generatePackets().size();
+		size += pmtGenerator.generatePackets().size();
+	}
+
+	QVERIFY((size > 0) && ((size % 188) == 0));
+}
+
+// DvbRecordingFile::pmtSectionChanged() passes the same pids again if only the pmt changes
+
+void SiBenchmark::updatePmt()
+{
+	DvbPmtSection section(pmtSection);
+	QVERIFY(section.isValid());
+	QList<int> pids;
+
+	for (DvbPmtSectionEntry entry = section.entries(); entry.isValid(); entry.advance()) {
+		pids.append(entry.pid());
+	}
+
+	DvbSectionGenerator pmtGenerator;
+	pmtGenerator.initPmt(pmtPid, section, pids);
+	QByteArray packets = pmtGenerator.generatePackets();
+
+	QBENCHMARK {
+		pmtGenerator.initPmt(pmtPid, section, pids);
+	}
+
+	// neither the version number nor the continuity counter have changed
+	QCOMPARE(pmtGenerator.generatePackets().mid(4), packets.mid(4));
+}
+
+QTEST_GUILESS_MAIN(SiBenchmark)
+
+#include "sibenchmark.moc"
@@ -52,6 +52,11 @@ void AbstractMediaWidget::connectToMediaWidget(MediaWidget *mediaWidget_)
 
 void AbstractMediaWidget::addPendingUpdates(PendingUpdates pendingUpdatesToBeAdded)
 {
+	if (mediaWidget == NULL) {
+		// the backend is used without controls (e.g. the dvb multi view)
+		return;
+	}
+
 	while (true) {
 		int oldValue = pendingUpdates;
 		int newValue = (oldValue | pendingUpdatesToBeAdded);
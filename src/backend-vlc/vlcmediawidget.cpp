@@ -20,12 +20,36 @@
 
 #include "vlcmediawidget.h"
 
+#include <QDateTime>
 #include <QMouseEvent>
+#include <limits>
 #include <vlc/vlc.h>
 #include "../log.h"
 
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3, 0, 0, 0)
+static int vlcStreamOpen(void *opaque, void **data, uint64_t *size)
+{
+	MediaSource *source = static_cast<MediaSource *>(opaque);
+	source->openStream();
+	*data = source;
+	*size = std::numeric_limits<uint64_t>::max(); // unknown
+	return 0;
+}
+
+static ssize_t vlcStreamRead(void *data, unsigned char *buffer, size_t size)
+{
+	return static_cast<MediaSource *>(data)->readStream(reinterpret_cast<char *>(buffer),
+		int(qMin(size, size_t(1 << 20))));
+}
+
+static void vlcStreamClose(void *data)
+{
+	Q_UNUSED(data)
+}
+#endif
+
 VlcMediaWidget::VlcMediaWidget(QWidget *parent) : AbstractMediaWidget(parent), vlcInstance(NULL),
-	vlcMediaPlayer(NULL), playingDvd(false)
+	vlcMediaPlayer(NULL), streamSource(NULL), playingDvd(false)
 {
 }
 
@@ -50,7 +74,11 @@ bool VlcMediaWidget::init()
 	libvlc_event_e eventTypes[] = { libvlc_MediaPlayerEncounteredError,
 		libvlc_MediaPlayerEndReached, libvlc_MediaPlayerLengthChanged,
 		libvlc_MediaPlayerSeekableChanged, libvlc_MediaPlayerStopped,
-		libvlc_MediaPlayerTimeChanged };
+		libvlc_MediaPlayerTimeChanged
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2, 2, 0, 0)
+		, libvlc_MediaPlayerVout
+#endif
+		};
 
 	for (uint i = 0; i < (sizeof(eventTypes) / sizeof(eventTypes[0])); ++i) {
 		if (libvlc_event_attach(eventManager, eventTypes[i], vlcEventHandler, this) != 0) {
@@ -66,6 +94,8 @@ bool VlcMediaWidget::init()
 
 VlcMediaWidget::~VlcMediaWidget()
 {
+	interruptStream();
+
 	if (vlcMediaPlayer != NULL) {
 		libvlc_media_player_release(vlcMediaPlayer);
 	}
@@ -140,9 +170,25 @@ void VlcMediaWidget::setDeinterlacing(bool deinterlacing)
 void VlcMediaWidget::play(const MediaSource &source)
 {
 	addPendingUpdates(PlaybackStatus | DvdMenu);
-	QByteArray url = source.getUrl().toEncoded();
+	interruptStream();
+	playTime.store(QDateTime::currentMSecsSinceEpoch());
+	libvlc_media_t *vlcMedia = NULL;
+	QByteArray url;
 	playingDvd = false;
 
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3, 0, 0, 0)
+	if (source.isStream()) {
+		// the data doesn't go through the file system
+		streamSource = const_cast<MediaSource *>(&source);
+		vlcMedia = libvlc_media_new_callbacks(vlcInstance, vlcStreamOpen, vlcStreamRead,
+			NULL, vlcStreamClose, streamSource);
+	}
+#endif
+
+	if (streamSource == NULL) {
+		url = source.getUrl().toEncoded();
+	}
+
 	switch (source.getType()) {
 	case MediaSource::Url:
 		if (url.endsWith(".iso")) {
@@ -179,11 +225,15 @@ void VlcMediaWidget::play(const MediaSource &source)
 		break;
 	}
 
-	libvlc_media_t *vlcMedia = libvlc_media_new_location(vlcInstance, url.constData());
+	if (streamSource == NULL) {
+		vlcMedia = libvlc_media_new_location(vlcInstance, url.constData());
+	}
 
 	if (vlcMedia == NULL) {
+		streamSource = NULL;
 		libvlc_media_player_stop(vlcMediaPlayer);
-		Log("VlcMediaWidget::play: cannot create media") << source.getUrl().toDisplayString();
+		ignoreEndReached.storeRelease(0);
+		Log("VlcMediaWidget::play: cannot create media") << QLatin1String(url.constData());
 		return;
 	}
 
@@ -198,6 +248,7 @@ void VlcMediaWidget::play(const MediaSource &source)
 
 	libvlc_media_player_set_media(vlcMediaPlayer, vlcMedia);
 	libvlc_media_release(vlcMedia);
+	ignoreEndReached.storeRelease(0);
 
 //	FIXME!
 
@@ -210,13 +261,15 @@ void VlcMediaWidget::play(const MediaSource &source)
 // 	}
 
 	if (libvlc_media_player_play(vlcMediaPlayer) != 0) {
-		Log("VlcMediaWidget::play: cannot play media") << source.getUrl().toDisplayString();
+		Log("VlcMediaWidget::play: cannot play media") << QLatin1String(url.constData());
 	}
 }
 
 void VlcMediaWidget::stop()
 {
+	interruptStream();
 	libvlc_media_player_stop(vlcMediaPlayer);
+	ignoreEndReached.storeRelease(0);
 }
 
 void VlcMediaWidget::setPaused(bool paused)
@@ -502,6 +555,18 @@ void VlcMediaWidget::mousePressEvent(QMouseEvent *event)
 	AbstractMediaWidget::mousePressEvent(event);
 }
 
+// libvlc_media_player_stop() waits until the stream returns
+
+void VlcMediaWidget::interruptStream()
+{
+	if (streamSource != NULL) {
+		// the end of the stream is caused by stopping, not by finished playback
+		ignoreEndReached.storeRelease(1);
+		streamSource->interruptStream();
+		streamSource = NULL;
+	}
+}
+
 void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 {
 	PendingUpdates pendingUpdatesToBeAdded = 0;
@@ -514,7 +579,12 @@ void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 		pendingUpdatesToBeAdded = PlaybackStatus;
 		break;
 	case libvlc_MediaPlayerEndReached:
-		pendingUpdatesToBeAdded = (PlaybackFinished | PlaybackStatus);
+		if (ignoreEndReached.loadAcquire() != 0) {
+			pendingUpdatesToBeAdded = PlaybackStatus;
+		} else {
+			pendingUpdatesToBeAdded = (PlaybackFinished | PlaybackStatus);
+		}
+
 		break;
 	case libvlc_MediaPlayerLengthChanged:
 		pendingUpdatesToBeAdded = CurrentTotalTime;
@@ -524,11 +594,25 @@ void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 		break;
 	case libvlc_MediaPlayerStopped:
 		playbackStatus = MediaWidget::Idle;
-		mediaWidget->playbackStatusChanged();
+
+		if (mediaWidget != NULL) {
+			mediaWidget->playbackStatusChanged();
+		}
+
 		break;
 	case libvlc_MediaPlayerTimeChanged:
 		pendingUpdatesToBeAdded = CurrentTotalTime;
 		break;
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(2, 2, 0, 0)
+	case libvlc_MediaPlayerVout:
+		if (event->u.media_player_vout.new_count > 0) {
+			// time to first frame (the video output is reused for later media)
+			Log("VlcMediaWidget::vlcEvent: video output started after") <<
+				(QDateTime::currentMSecsSinceEpoch() - playTime.load()) << "ms";
+		}
+
+		return;
+#endif
 	}
 
 	if (pendingUpdatesToBeAdded != 0) {
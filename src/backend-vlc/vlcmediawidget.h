@@ -21,6 +21,7 @@
 #ifndef VLCMEDIAWIDGET_H
 #define VLCMEDIAWIDGET_H
 
+#include <QAtomicInteger>
 #include "../abstractmediawidget.h"
 
 class libvlc_event_t;
@@ -72,12 +73,16 @@ public:
 
 private:
 	void mousePressEvent(QMouseEvent *event);
+	void interruptStream();
 	void vlcEvent(const libvlc_event_t *event);
 
 	static void vlcEventHandler(const libvlc_event_t *event, void *instance);
 
 	libvlc_instance_t *vlcInstance;
 	libvlc_media_player_t *vlcMediaPlayer;
+	MediaSource *streamSource;
+	QAtomicInt ignoreEndReached;
+	QAtomicInteger<qint64> playTime; // msecs since epoch; set by play(), read by vlcEvent()
 	bool playingDvd;
 };
 
@@ -81,8 +81,17 @@ public:
 class DvbPidFilter
 {
 public:
+	// may be called from the demux thread of the device (see DvbDevice)
 	virtual void processData(const char data[188]) = 0;
 
+	// count consecutive packets with the same pid; override it to avoid per packet overhead
+	virtual void processPackets(const char *data, int count)
+	{
+		for (int i = 0; i < count; ++i) {
+			processData(data + (i * 188));
+		}
+	}
+
 protected:
 	DvbPidFilter() { }
 	virtual ~DvbPidFilter() { }
@@ -92,8 +101,17 @@ class DvbSectionFilter
 {
 public:
 	// the crc is either valid or has appeared at least twice
+	// always called from the thread the device belongs to
 	virtual void processSection(const char *data, int size) = 0;
 
+	// if true, unchanged repetitions of sections (same table id, table id extension,
+	// section number and crc) are skipped; a section may still be passed more than once
+	// the value mustn't change while the filter is added
+	virtual bool isChangesOnly() const
+	{
+		return false;
+	}
+
 protected:
 	DvbSectionFilter() { }
 	virtual ~DvbSectionFilter() { }
@@ -134,6 +152,10 @@ public:
 	virtual bool isTuned() = 0;
 	virtual int getSignal() = 0; // 0 - 100 [%] or -1 = not supported
 	virtual int getSnr() = 0; // 0 - 100 [%] or -1 = not supported
+	// corruption statistics of the received stream (totals, safe to call at any time)
+	virtual int getSyncLossCount() = 0;
+	virtual int getTransportErrorCount() = 0; // packets with the transport error indicator
+	virtual qint64 getSkippedBytes() = 0; // skipped while looking for the sync bytes
 	virtual bool addPidFilter(int pid) = 0;
 	virtual void removePidFilter(int pid) = 0;
 	virtual void startDescrambling(const QByteArray &pmtSectionData) = 0;
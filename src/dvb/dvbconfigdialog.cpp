@@ -87,6 +87,22 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 	gridLayout->addWidget(toolButton, 1, 2);
 	boxLayout->addLayout(gridLayout);
 
+	gridLayout = new QGridLayout();
+	gridLayout->addWidget(new QLabel(i18n("Time shift buffer size (MiB):")), 0, 0);
+
+	timeShiftSizeBox = new QSpinBox(widget);
+	timeShiftSizeBox->setRange(16, 65536);
+	timeShiftSizeBox->setValue(manager->getTimeShiftSize());
+	gridLayout->addWidget(timeShiftSizeBox, 0, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Always keep a time shift buffer of the current channel:")),
+		1, 0);
+
+	timeShiftAlwaysBox = new QCheckBox(widget);
+	timeShiftAlwaysBox->setChecked(manager->isTimeShiftAlwaysEnabled());
+	gridLayout->addWidget(timeShiftAlwaysBox, 1, 1);
+	boxLayout->addLayout(gridLayout);
+
 	gridLayout = new QGridLayout();
 	gridLayout->addWidget(new QLabel(i18n("Begin margin (minutes):")), 2, 0);
 
@@ -116,6 +132,49 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 	frame->setFrameShape(QFrame::HLine);
 	boxLayout->addWidget(frame);
 
+	boxLayout->addWidget(new QLabel(i18n("Device access (takes effect after a restart)")));
+
+	gridLayout = new QGridLayout();
+	gridLayout->addWidget(new QLabel(i18n("Shared reader threads:")), 0, 0);
+
+	readerThreadsBox = new QSpinBox(widget);
+	readerThreadsBox->setRange(0, 64);
+	readerThreadsBox->setSpecialValueText(i18n("One per device"));
+	readerThreadsBox->setValue(manager->getReaderThreadCount());
+	gridLayout->addWidget(readerThreadsBox, 0, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("CPUs of the reader threads (e.g. 2, 3):")), 1, 0);
+
+	QStringList cpus;
+
+	foreach (int cpu, manager->getReaderThreadCpus()) {
+		cpus.append(QString::number(cpu));
+	}
+
+	readerThreadCpusEdit = new KLineEdit(widget);
+	readerThreadCpusEdit->setText(cpus.join(QLatin1String(", ")));
+	gridLayout->addWidget(readerThreadCpusEdit, 1, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Use a single demux device per adapter:")), 2, 0);
+
+	singleDemuxBox = new QCheckBox(widget);
+	singleDemuxBox->setChecked(manager->isSingleDemuxEnabled());
+	gridLayout->addWidget(singleDemuxBox, 2, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Receive the whole stream from this number of pids:")),
+		3, 0);
+
+	fullTsPidCountBox = new QSpinBox(widget);
+	fullTsPidCountBox->setRange(0, 8192);
+	fullTsPidCountBox->setSpecialValueText(i18n("Never"));
+	fullTsPidCountBox->setValue(manager->getFullTsPidCount());
+	gridLayout->addWidget(fullTsPidCountBox, 3, 1);
+	boxLayout->addLayout(gridLayout);
+
+	frame = new QFrame(widget);
+	frame->setFrameShape(QFrame::HLine);
+	boxLayout->addWidget(frame);
+
 	boxLayout->addWidget(new QLabel(i18n("Scan data last updated on %1",
 		QLocale().toString(manager->getScanDataDate(), QLocale::ShortFormat))));
 
@@ -358,9 +417,29 @@ void DvbConfigDialog::accept()
 {
 	manager->setRecordingFolder(recordingFolderEdit->text());
 	manager->setTimeShiftFolder(timeShiftFolderEdit->text());
+	manager->setTimeShiftSize(timeShiftSizeBox->value());
+	manager->setTimeShiftAlways(timeShiftAlwaysBox->isChecked());
 	manager->setBeginMargin(beginMarginBox->value() * 60);
 	manager->setEndMargin(endMarginBox->value() * 60);
 	manager->setOverride6937Charset(override6937CharsetBox->isChecked());
+	manager->setReaderThreadCount(readerThreadsBox->value());
+	manager->setSingleDemuxEnabled(singleDemuxBox->isChecked());
+	manager->setFullTsPidCount(fullTsPidCountBox->value());
+
+	QStringList cpuTexts =
+		readerThreadCpusEdit->text().split(QLatin1Char(','), QString::SkipEmptyParts);
+	QList<int> cpus;
+
+	foreach (const QString &text, cpuTexts) {
+		bool ok;
+		int cpu = text.trimmed().toInt(&ok);
+
+		if (ok && (cpu >= 0)) {
+			cpus.append(cpu);
+		}
+	}
+
+	manager->setReaderThreadCpus(cpus);
 
 	bool latitudeOk;
 	bool longitudeOk;
@@ -377,6 +456,10 @@ void DvbConfigDialog::accept()
 	foreach (DvbConfigPage *configPage, configPages) {
 		DvbDeviceConfigUpdate configUpdate(configPage->getDeviceConfig());
 		configUpdate.configs = configPage->getConfigs();
+		configUpdate.bufferSize = configPage->getBufferSize();
+		configUpdate.bufferCount = configPage->getBufferCount();
+		configUpdate.lockBuffers = configPage->isBufferLockingEnabled();
+		configUpdate.demuxThread = configPage->isDemuxThreadEnabled();
 		configUpdates.append(configUpdate);
 	}
 
@@ -457,6 +540,7 @@ void DvbScanFileDownloadDialog::jobFinished()
 
 DvbConfigPage::DvbConfigPage(QWidget *parent, DvbManager *manager,
 	const DvbDeviceConfig *deviceConfig_) : QWidget(parent), deviceConfig(deviceConfig_),
+	bufferSizeBox(NULL), bufferCountBox(NULL), lockBuffersBox(NULL), demuxThreadBox(NULL),
 	dvbSObject(NULL)
 {
 	boxLayout = new QVBoxLayout(this);
@@ -490,6 +574,47 @@ DvbConfigPage::DvbConfigPage(QWidget *parent, DvbManager *manager,
 		return;
 	}
 
+	QGridLayout *gridLayout = new QGridLayout();
+	gridLayout->addWidget(new QLabel(i18n("Data buffer size (KiB):")), 0, 0);
+
+	bufferSizeBox = new QSpinBox(this);
+	bufferSizeBox->setRange((DvbDevice::MinimumBufferSize + 1023) / 1024,
+		DvbDevice::MaximumBufferSize / 1024);
+	bufferSizeBox->setValue((deviceConfig->bufferSize + 512) / 1024);
+	connect(this, SIGNAL(resetConfig()), this, SLOT(resetDataOptions()));
+	gridLayout->addWidget(bufferSizeBox, 0, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Number of data buffers:")), 1, 0);
+
+	bufferCountBox = new QSpinBox(this);
+	bufferCountBox->setRange(DvbDevice::MinimumBufferCount, DvbDevice::MaximumBufferCount);
+	bufferCountBox->setValue(deviceConfig->bufferCount);
+	gridLayout->addWidget(bufferCountBox, 1, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Lock data buffers in memory:")), 2, 0);
+
+	lockBuffersBox = new QCheckBox(this);
+	lockBuffersBox->setChecked(deviceConfig->lockBuffers);
+	gridLayout->addWidget(lockBuffersBox, 2, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Process data in a separate thread:")), 3, 0);
+
+	demuxThreadBox = new QCheckBox(this);
+	demuxThreadBox->setChecked(deviceConfig->demuxThread);
+	gridLayout->addWidget(demuxThreadBox, 3, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Data dropped due to overload:")), 4, 0);
+	gridLayout->addWidget(new QLabel(i18n("%1 KiB (%2 times no free buffer)",
+		(deviceConfig->device->getDroppedBytes() + 1023) / 1024,
+		deviceConfig->device->getExhaustedBufferCount())), 4, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Stream errors:")), 5, 0);
+	gridLayout->addWidget(new QLabel(i18n("%1 sync losses (%2 KiB skipped), "
+		"%3 packets with transport errors", deviceConfig->device->getSyncLossCount(),
+		(deviceConfig->device->getSkippedBytes() + 1023) / 1024,
+		deviceConfig->device->getTransportErrorCount())), 5, 1);
+	boxLayout->addLayout(gridLayout);
+
 	DvbDevice::TransmissionTypes transmissionTypes =
 		deviceConfig->device->getTransmissionTypes();
 
@@ -606,6 +731,43 @@ QList<DvbConfig> DvbConfigPage::getConfigs()
 	return configs;
 }
 
+int DvbConfigPage::getBufferSize() const
+{
+	if (bufferSizeBox == NULL) {
+		return deviceConfig->bufferSize;
+	}
+
+	// DvbDevice rounds down to a multiple of 188
+	return (bufferSizeBox->value() * 1024);
+}
+
+int DvbConfigPage::getBufferCount() const
+{
+	if (bufferCountBox == NULL) {
+		return deviceConfig->bufferCount;
+	}
+
+	return bufferCountBox->value();
+}
+
+bool DvbConfigPage::isBufferLockingEnabled() const
+{
+	if (lockBuffersBox == NULL) {
+		return deviceConfig->lockBuffers;
+	}
+
+	return lockBuffersBox->isChecked();
+}
+
+bool DvbConfigPage::isDemuxThreadEnabled() const
+{
+	if (demuxThreadBox == NULL) {
+		return deviceConfig->demuxThread;
+	}
+
+	return demuxThreadBox->isChecked();
+}
+
 void DvbConfigPage::moveLeft()
 {
 	emit moveLeft(this);
@@ -621,6 +783,14 @@ void DvbConfigPage::removeConfig()
 	emit remove(this);
 }
 
+void DvbConfigPage::resetDataOptions()
+{
+	bufferSizeBox->setValue(DvbDevice::DefaultBufferSize / 1024);
+	bufferCountBox->setValue(DvbDevice::DefaultBufferCount);
+	lockBuffersBox->setChecked(false);
+	demuxThreadBox->setChecked(false);
+}
+
 void DvbConfigPage::addHSeparator(const QString &title)
 {
 	QFrame *frame = new QFrame(this);
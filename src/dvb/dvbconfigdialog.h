@@ -76,9 +76,15 @@ private:
 	QTabWidget *tabWidget;
 	KLineEdit *recordingFolderEdit;
 	KLineEdit *timeShiftFolderEdit;
+	QSpinBox *timeShiftSizeBox;
+	QCheckBox *timeShiftAlwaysBox;
 	QSpinBox *beginMarginBox;
 	QSpinBox *endMarginBox;
 	QCheckBox *override6937CharsetBox;
+	QSpinBox *readerThreadsBox;
+	KLineEdit *readerThreadCpusEdit;
+	QCheckBox *singleDemuxBox;
+	QSpinBox *fullTsPidCountBox;
 	KLineEdit *latitudeEdit;
 	KLineEdit *longitudeEdit;
 	QPixmap validPixmap;
@@ -121,6 +127,10 @@ public:
 
 	const DvbDeviceConfig *getDeviceConfig() const;
 	QList<DvbConfig> getConfigs();
+	int getBufferSize() const;
+	int getBufferCount() const;
+	bool isBufferLockingEnabled() const;
+	bool isDemuxThreadEnabled() const;
 
 signals:
 	void moveLeft(DvbConfigPage *page);
@@ -132,12 +142,17 @@ private slots:
 	void moveLeft();
 	void moveRight();
 	void removeConfig();
+	void resetDataOptions();
 
 private:
 	void addHSeparator(const QString &title);
 
 	const DvbDeviceConfig *deviceConfig;
 	QBoxLayout *boxLayout;
+	QSpinBox *bufferSizeBox;
+	QSpinBox *bufferCountBox;
+	QCheckBox *lockBuffersBox;
+	QCheckBox *demuxThreadBox;
 	QPushButton *moveLeftButton;
 	QPushButton *moveRightButton;
 	QList<DvbConfig> configs;
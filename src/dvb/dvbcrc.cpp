@@ -0,0 +1,352 @@
+/*
+ * dvbcrc.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbcrc.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define DVBCRC_PCLMUL
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define DVBCRC_ARMCRC
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+static const quint32 crc32Polynomial = 0x04c11db7;
+
+class DvbCrc32Tables
+{
+public:
+	DvbCrc32Tables()
+	{
+		for (int i = 0; i < 256; ++i) {
+			quint32 value = (quint32(i) << 24);
+
+			for (int j = 0; j < 8; ++j) {
+				value = ((value << 1) ^ (((value & 0x80000000) != 0) ? crc32Polynomial : 0));
+			}
+
+			table[0][i] = value;
+		}
+
+		// table[k][i] is the crc of byte i followed by k zero bytes
+		for (int k = 1; k < 8; ++k) {
+			for (int i = 0; i < 256; ++i) {
+				quint32 value = table[k - 1][i];
+				table[k][i] = ((value << 8) ^ table[0][value >> 24]);
+			}
+		}
+	}
+
+	quint32 table[8][256];
+};
+
+static const DvbCrc32Tables &crc32Tables()
+{
+	static const DvbCrc32Tables tables;
+	return tables;
+}
+
+// x^n mod P
+
+static quint32 crc32PowerOfX(int n)
+{
+	quint32 value = 1;
+
+	for (int i = 0; i < n; ++i) {
+		value = ((value << 1) ^ (((value & 0x80000000) != 0) ? crc32Polynomial : 0));
+	}
+
+	return value;
+}
+
+static quint32 updateBytewise(quint32 crc, const char *data, int size)
+{
+	const quint32 *table = crc32Tables().table[0];
+
+	for (int i = 0; i < size; ++i) {
+		crc = ((crc << 8) ^ table[(crc >> 24) ^ quint8(data[i])]);
+	}
+
+	return crc;
+}
+
+static quint32 updateSlicingBy8(quint32 crc, const char *data, int size)
+{
+	const DvbCrc32Tables &tables = crc32Tables();
+	const quint8 *bytes = reinterpret_cast<const quint8 *>(data);
+
+	for (; size >= 8; size -= 8) {
+		quint32 value = (crc ^ ((quint32(bytes[0]) << 24) | (quint32(bytes[1]) << 16) |
+			(quint32(bytes[2]) << 8) | quint32(bytes[3])));
+		crc = (tables.table[7][value >> 24] ^ tables.table[6][(value >> 16) & 0xff] ^
+			tables.table[5][(value >> 8) & 0xff] ^ tables.table[4][value & 0xff] ^
+			tables.table[3][bytes[4]] ^ tables.table[2][bytes[5]] ^
+			tables.table[1][bytes[6]] ^ tables.table[0][bytes[7]]);
+		bytes += 8;
+	}
+
+	for (; size > 0; --size) {
+		crc = ((crc << 8) ^ tables.table[0][(crc >> 24) ^ *bytes]);
+		++bytes;
+	}
+
+	return crc;
+}
+
+#ifdef DVBCRC_PCLMUL
+
+// folding constants (x^n mod P) for a distance of 512 and 128 bits
+
+class DvbCrc32PclmulConstants
+{
+public:
+	DvbCrc32PclmulConstants() : fold512(crc32PowerOfX(512 + 64), crc32PowerOfX(512)),
+		fold128(crc32PowerOfX(128 + 64), crc32PowerOfX(128)), power96(crc32PowerOfX(96)),
+		power64(crc32PowerOfX(64)) { }
+
+	class Pair
+	{
+	public:
+		Pair(quint32 high_, quint32 low_) : high(high_), low(low_) { }
+
+		quint64 high;
+		quint64 low;
+	};
+
+	Pair fold512;
+	Pair fold128;
+	quint64 power96;
+	quint64 power64;
+};
+
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i foldPclmul(__m128i value, __m128i constants, __m128i next)
+{
+	// value * x^distance = high * x^(distance + 64) + low * x^distance
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(value, constants, 0x11),
+		_mm_clmulepi64_si128(value, constants, 0x00)), next);
+}
+
+__attribute__((target("pclmul,ssse3")))
+static quint32 updatePclmul(quint32 crc, const char *data, int size)
+{
+	if (size < 64) {
+		return updateSlicingBy8(crc, data, size);
+	}
+
+	static const DvbCrc32PclmulConstants constants;
+	const __m128i byteSwap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i *blocks = reinterpret_cast<const __m128i *>(data);
+	int blockCount = (size / 16);
+
+	// the first byte of the data is the most significant one
+	__m128i values[4];
+
+	for (int i = 0; i < 4; ++i) {
+		values[i] = _mm_shuffle_epi8(_mm_loadu_si128(blocks + i), byteSwap);
+	}
+
+	values[0] = _mm_xor_si128(values[0], _mm_set_epi32(int(crc), 0, 0, 0));
+	int block = 4;
+
+	const __m128i fold512 = _mm_set_epi64x(qint64(constants.fold512.high),
+		qint64(constants.fold512.low));
+
+	for (; (block + 4) <= blockCount; block += 4) {
+		for (int i = 0; i < 4; ++i) {
+			values[i] = foldPclmul(values[i], fold512,
+				_mm_shuffle_epi8(_mm_loadu_si128(blocks + block + i), byteSwap));
+		}
+	}
+
+	const __m128i fold128 = _mm_set_epi64x(qint64(constants.fold128.high),
+		qint64(constants.fold128.low));
+	__m128i value = foldPclmul(values[0], fold128, values[1]);
+	value = foldPclmul(value, fold128, values[2]);
+	value = foldPclmul(value, fold128, values[3]);
+
+	for (; block < blockCount; ++block) {
+		value = foldPclmul(value, fold128,
+			_mm_shuffle_epi8(_mm_loadu_si128(blocks + block), byteSwap));
+	}
+
+	// reduce to 64 bits: (h1 * x^96 + h0 * x^64 + low) mod P
+	quint64 high = quint64(_mm_cvtsi128_si64(_mm_unpackhi_epi64(value, value)));
+	quint64 low = quint64(_mm_cvtsi128_si64(value));
+	__m128i factors = _mm_set_epi64x(qint64(high >> 32), qint64(high & 0xffffffff));
+	__m128i powers = _mm_set_epi64x(qint64(constants.power96), qint64(constants.power64));
+	low ^= quint64(_mm_cvtsi128_si64(_mm_clmulepi64_si128(factors, powers, 0x11)));
+	low ^= quint64(_mm_cvtsi128_si64(_mm_clmulepi64_si128(factors, powers, 0x00)));
+
+	// the crc of the remaining 64 bits (starting with zero) is the crc of the folded data
+	char remainder[8];
+
+	for (int i = 0; i < 8; ++i) {
+		remainder[i] = char(low >> (56 - (8 * i)));
+	}
+
+	crc = updateSlicingBy8(0, remainder, 8);
+	return updateSlicingBy8(crc, data + (blockCount * 16), size - (blockCount * 16));
+}
+
+#endif /* DVBCRC_PCLMUL */
+
+#ifdef DVBCRC_ARMCRC
+
+// the crc32 instructions work with the bit-reflected polynomial; reflecting the data
+// and the state gives the same result as the msb first variant
+
+static inline quint64 bitReverse64(quint64 value)
+{
+	quint64 result;
+	__asm__("rbit %0, %1" : "=r" (result) : "r" (value));
+	return result;
+}
+
+static inline quint32 bitReverse32(quint32 value)
+{
+	quint32 result;
+	__asm__("rbit %w0, %w1" : "=r" (result) : "r" (value));
+	return result;
+}
+
+__attribute__((target("+crc")))
+static quint32 updateArmCrc(quint32 crc, const char *data, int size)
+{
+	quint32 state = bitReverse32(crc);
+
+	for (; size >= 8; size -= 8) {
+		quint64 value;
+		memcpy(&value, data, 8);
+		state = __crc32d(state, __builtin_bswap64(bitReverse64(value)));
+		data += 8;
+	}
+
+	for (; size > 0; --size) {
+		state = __crc32b(state, quint8(bitReverse32(quint8(*data)) >> 24));
+		++data;
+	}
+
+	return bitReverse32(state);
+}
+
+#endif /* DVBCRC_ARMCRC */
+
+typedef quint32 (*DvbCrc32Function)(quint32 crc, const char *data, int size);
+
+static DvbCrc32Function crc32Function(DvbCrc32::Implementation implementation)
+{
+	switch (implementation) {
+	case DvbCrc32::Bytewise:
+		return updateBytewise;
+	case DvbCrc32::SlicingBy8:
+		return updateSlicingBy8;
+	case DvbCrc32::Pclmul:
+#ifdef DVBCRC_PCLMUL
+		return updatePclmul;
+#else
+		break;
+#endif
+	case DvbCrc32::ArmCrc:
+#ifdef DVBCRC_ARMCRC
+		return updateArmCrc;
+#else
+		break;
+#endif
+	case DvbCrc32::ImplementationCount:
+		break;
+	}
+
+	return updateSlicingBy8;
+}
+
+quint32 DvbCrc32::update(quint32 crc, const char *data, int size)
+{
+	static const DvbCrc32Function function = crc32Function(bestImplementation());
+	return function(crc, data, size);
+}
+
+DvbCrc32::Implementation DvbCrc32::bestImplementation()
+{
+	if (isSupported(Pclmul)) {
+		return Pclmul;
+	}
+
+	if (isSupported(ArmCrc)) {
+		return ArmCrc;
+	}
+
+	return SlicingBy8;
+}
+
+bool DvbCrc32::isSupported(Implementation implementation)
+{
+	switch (implementation) {
+	case Bytewise:
+	case SlicingBy8:
+		return true;
+	case Pclmul:
+#ifdef DVBCRC_PCLMUL
+		return (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"));
+#else
+		return false;
+#endif
+	case ArmCrc:
+#ifdef DVBCRC_ARMCRC
+		return ((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0);
+#else
+		return false;
+#endif
+	case ImplementationCount:
+		break;
+	}
+
+	return false;
+}
+
+const char *DvbCrc32::implementationName(Implementation implementation)
+{
+	switch (implementation) {
+	case Bytewise:
+		return "bytewise";
+	case SlicingBy8:
+		return "slicing-by-8";
+	case Pclmul:
+		return "pclmul";
+	case ArmCrc:
+		return "armv8-crc";
+	case ImplementationCount:
+		break;
+	}
+
+	return "";
+}
+
+quint32 DvbCrc32::update(Implementation implementation, quint32 crc, const char *data, int size)
+{
+	Q_ASSERT(isSupported(implementation));
+	return crc32Function(implementation)(crc, data, size);
+}
@@ -0,0 +1,61 @@
+/*
+ * dvbcrc.h
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBCRC_H
+#define DVBCRC_H
+
+#include <QtGlobal>
+
+// crc32 as used by mpeg-2 sections (polynomial 0x04c11db7, msb first, no final xor);
+// the fastest implementation supported by the cpu is picked at runtime
+
+class DvbCrc32
+{
+public:
+	enum Implementation {
+		Bytewise = 0,
+		SlicingBy8 = 1,
+		Pclmul = 2, // x86 carry-less multiplication
+		ArmCrc = 3, // armv8 crc32 instructions
+		ImplementationCount = 4
+	};
+
+	// the crc over a complete section (including its crc) is zero if the section is valid
+	static quint32 compute(const char *data, int size)
+	{
+		return update(0xffffffff, data, size);
+	}
+
+	static quint32 update(quint32 crc, const char *data, int size);
+
+	static Implementation bestImplementation();
+	static bool isSupported(Implementation implementation);
+	static const char *implementationName(Implementation implementation);
+
+	// for testing and benchmarking; the implementation has to be supported
+	static quint32 update(Implementation implementation, quint32 crc, const char *data,
+		int size);
+
+private:
+	DvbCrc32();
+	~DvbCrc32();
+};
+
+#endif /* DVBCRC_H */
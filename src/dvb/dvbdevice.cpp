@@ -23,7 +23,14 @@
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QHash>
+#include <QSocketNotifier>
+#include <QThread>
 #include <cmath>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include "../log.h"
 #include "dvbconfig.h"
@@ -37,34 +44,86 @@ public:
 	~DvbFilterInternal() { }
 
 	QList<DvbPidFilter *> filters;
-	int activeFilters;
+	int activeFilters; // the data dumper isn't counted
 };
 
+// reassembles the sections of a pid; the complete sections are handed over to
+// DvbDevice::processSections(), which runs in the thread owning the device
+
 class DvbSectionFilterInternal : public DvbPidFilter
 {
 public:
-	DvbSectionFilterInternal() : activeSectionFilters(0), continuityCounter(0),
-		wrongCrcIndex(0), bufferValid(false)
+	DvbSectionFilterInternal(DvbDevice *device_, int pid_) : device(device_), pid(pid_),
+		continuityCounter(0), wrongCrcIndex(0), bufferValid(false), bufferSize(0),
+		allSectionsFilters(0), changesOnlyFilters(0), cacheResetRequested(0)
 	{
 		memset(wrongCrcs, 0, sizeof(wrongCrcs));
 	}
 
 	~DvbSectionFilterInternal() { }
 
-	QList<DvbSectionFilter *> sectionFilters;
-	int activeSectionFilters;
+	void addSectionFilter(DvbSectionFilter *filter);
+	void removeSectionFilter(DvbSectionFilter *filter);
+
+	QList<DvbSectionFilter *> sectionFilters; // not accessed by the demux thread
 
 private:
+	enum {
+		MaximumSectionSize = 4098, // 12 bit section length + header
+		CacheGenerationSize = 32768 // a full eit schedule of a large satellite multiplex
+	};
+
 	void processData(const char [188]);
-	void processSections(bool force);
+	int continueSection(const char *data, int size); // returns the number of used bytes
+	void startSections(const char *data, int size);
+	void processSection(const char *data, int size);
+	bool isRepetition(const char *data, int size);
 
+	DvbDevice *device;
+	int pid;
 	unsigned char continuityCounter;
 	unsigned char wrongCrcIndex;
 	bool bufferValid;
-	QByteArray buffer;
 	int wrongCrcs[8];
+
+	// sections which fit into a packet are processed in place; only sections spanning
+	// multiple packets are collected here
+	int bufferSize;
+	char buffer[MaximumSectionSize];
+
+	// the section caches (section -> crc) are only accessed by the demux thread; sections
+	// which haven't been seen during a whole generation are dropped
+	QHash<quint64, quint32> sectionCache;
+	QHash<quint64, quint32> previousSectionCache;
+	QAtomicInt allSectionsFilters;
+	QAtomicInt changesOnlyFilters;
+	QAtomicInt cacheResetRequested;
 };
 
+void DvbSectionFilterInternal::addSectionFilter(DvbSectionFilter *filter)
+{
+	sectionFilters.append(filter);
+
+	if (filter->isChangesOnly()) {
+		// the new filter has to see the current sections at least once
+		cacheResetRequested.storeRelease(1);
+		changesOnlyFilters.ref();
+	} else {
+		allSectionsFilters.ref();
+	}
+}
+
+void DvbSectionFilterInternal::removeSectionFilter(DvbSectionFilter *filter)
+{
+	sectionFilters.removeOne(filter);
+
+	if (filter->isChangesOnly()) {
+		changesOnlyFilters.deref();
+	} else {
+		allSectionsFilters.deref();
+	}
+}
+
 // FIXME some debug messages may be printed too often
 
 void DvbSectionFilterInternal::processData(const char data[188])
@@ -86,6 +145,7 @@ void DvbSectionFilterInternal::processData(const char data[188])
 		if (continuity != ((continuityCounter + 1) & 0x0f)) {
 			Log("DvbSectionFilterInternal::processData: discontinuity");
 			bufferValid = false;
+			bufferSize = 0;
 		}
 	}
 
@@ -122,91 +182,178 @@ void DvbSectionFilterInternal::processData(const char data[188])
 			pointer = (payloadLength - 1);
 		}
 
-		if (bufferValid) {
-			buffer.append(payload + 1, pointer);
-			processSections(true);
-		} else {
-			bufferValid = true;
+		if (bufferSize > 0) {
+			continueSection(payload + 1, pointer);
+
+			if (bufferSize >= 3) {
+				Log("DvbSectionFilterInternal::processData: short section");
+				processSection(buffer, bufferSize);
+			} else if (bufferSize > 0) {
+				Log("DvbSectionFilterInternal::processData: stray data");
+			}
+
+			bufferSize = 0;
 		}
 
-		payload += (pointer + 1);
-		payloadLength -= (pointer + 1);
-	}
+		bufferValid = true;
+		startSections(payload + pointer + 1, payloadLength - pointer - 1);
+	} else if (bufferSize > 0) {
+		int usedLength = continueSection(payload, payloadLength);
 
-	buffer.append(payload, payloadLength);
-	processSections(false);
+		if (bufferSize == 0) {
+			startSections(payload + usedLength, payloadLength - usedLength);
+		}
+	}
 }
 
-void DvbSectionFilterInternal::processSections(bool force)
+int DvbSectionFilterInternal::continueSection(const char *data, int size)
 {
-	const char *it = buffer.constBegin();
-	const char *end = buffer.constEnd();
+	int usedSize = 0;
 
-	while (it != end) {
-		if (static_cast<unsigned char>(it[0]) == 0xff) {
-			// table id == 0xff means padding
-			it = end;
-			break;
+	if (bufferSize < 3) {
+		// the section header is incomplete
+		usedSize = qMin(3 - bufferSize, size);
+		memcpy(buffer + bufferSize, data, usedSize);
+		bufferSize += usedSize;
+
+		if (bufferSize < 3) {
+			return usedSize;
 		}
+	}
 
-		if ((end - it) < 3) {
-			if (force) {
-				Log("DvbSectionFilterInternal::processSections: stray data");
-				it = end;
-			}
+	int sectionSize = ((((quint8(buffer[1]) & 0x0f) << 8) | quint8(buffer[2])) + 3);
+	int copySize = qMin(sectionSize - bufferSize, size - usedSize);
+	memcpy(buffer + bufferSize, data + usedSize, copySize);
+	bufferSize += copySize;
+	usedSize += copySize;
 
-			break;
+	if (bufferSize == sectionSize) {
+		processSection(buffer, sectionSize);
+		bufferSize = 0;
+	}
+
+	return usedSize;
+}
+
+void DvbSectionFilterInternal::startSections(const char *data, int size)
+{
+	while (size > 0) {
+		if (quint8(data[0]) == 0xff) {
+			// table id == 0xff means padding
+			return;
 		}
 
-		const char *sectionEnd = (it + (((static_cast<unsigned char>(it[1]) & 0x0f) << 8) |
-			static_cast<unsigned char>(it[2])) + 3);
+		if (size >= 3) {
+			int sectionSize = ((((quint8(data[1]) & 0x0f) << 8) | quint8(data[2])) + 3);
 
-		if (force && (sectionEnd > end)) {
-			Log("DvbSectionFilterInternal::processSections: short section");
-			sectionEnd = end;
+			if (sectionSize <= size) {
+				// the section is contained completely in the packet
+				processSection(data, sectionSize);
+				data += sectionSize;
+				size -= sectionSize;
+				continue;
+			}
 		}
 
-		if (sectionEnd <= end) {
-			int size = int(sectionEnd - it);
-			int crc = DvbStandardSection::verifyCrc32(it, size);
-			bool crcOk;
+		// the section continues in the next packet
+		memcpy(buffer, data, size);
+		bufferSize = size;
+		return;
+	}
+}
 
-			if (crc == 0) {
-				crcOk = true;
-			} else {
-				for (int i = 0;; ++i) {
-					if (i == (sizeof(wrongCrcs) / sizeof(wrongCrcs[0]))) {
-						crcOk = false;
-						wrongCrcs[wrongCrcIndex] = crc;
-
-						if ((++wrongCrcIndex) == i) {
-							wrongCrcIndex = 0;
-						}
-
-						break;
-					}
-
-					if (wrongCrcs[i] == crc) {
-						crcOk = true;
-						break;
-					}
+void DvbSectionFilterInternal::processSection(const char *data, int size)
+{
+	int crc = DvbStandardSection::verifyCrc32(data, size);
+	bool crcOk;
+
+	if (crc == 0) {
+		crcOk = true;
+	} else {
+		for (int i = 0;; ++i) {
+			if (i == (sizeof(wrongCrcs) / sizeof(wrongCrcs[0]))) {
+				crcOk = false;
+				wrongCrcs[wrongCrcIndex] = crc;
+
+				if ((++wrongCrcIndex) == i) {
+					wrongCrcIndex = 0;
 				}
+
+				break;
 			}
 
-			if (crcOk) {
-				for (int i = 0; i < sectionFilters.size(); ++i) {
-					sectionFilters.at(i)->processSection(it, size);
-				}
+			if (wrongCrcs[i] == crc) {
+				crcOk = true;
+				break;
 			}
+		}
+	}
 
-			it = sectionEnd;
-			continue;
+	if (crcOk) {
+		bool repeated = isRepetition(data, size);
+
+		if (!repeated || (allSectionsFilters.loadAcquire() != 0)) {
+			// sections spanning multiple packets are in 'buffer', which is reused
+			device->queueSection(pid, data, size, repeated, data != buffer);
+		}
+	}
+}
+
+bool DvbSectionFilterInternal::isRepetition(const char *data, int size)
+{
+	if (cacheResetRequested.fetchAndStoreOrdered(0) != 0) {
+		sectionCache.clear();
+		previousSectionCache.clear();
+	}
+
+	if ((changesOnlyFilters.loadAcquire() == 0) || ((data[1] & 0x80) == 0) || (size < 12)) {
+		// nobody is interested or not a section with the standard syntax
+		return false;
+	}
+
+	// table id, table id extension and section number (plus transport stream id and original
+	// network id for the eit); a new version replaces the old one, because the crc (which
+	// covers the version) isn't part of the key
+	unsigned char tableId = data[0];
+	quint64 key = ((quint64(tableId) << 56) | (quint64(quint8(data[3])) << 48) |
+		(quint64(quint8(data[4])) << 40) | (quint64(quint8(data[6])) << 32));
+
+	if ((tableId >= 0x4e) && (tableId <= 0x6f)) {
+		key |= ((quint64(quint8(data[8])) << 24) | (quint64(quint8(data[9])) << 16) |
+			(quint64(quint8(data[10])) << 8) | quint64(quint8(data[11])));
+	}
+
+	quint32 crc = ((quint32(quint8(data[size - 4])) << 24) |
+		(quint32(quint8(data[size - 3])) << 16) | (quint32(quint8(data[size - 2])) << 8) |
+		quint32(quint8(data[size - 1])));
+
+	QHash<quint64, quint32>::iterator it = sectionCache.find(key);
+
+	if (it != sectionCache.end()) {
+		if (*it == crc) {
+			return true;
 		}
 
-		break;
+		*it = crc;
+		return false;
+	}
+
+	if (sectionCache.size() >= CacheGenerationSize) {
+		previousSectionCache.swap(sectionCache);
+		sectionCache.clear();
 	}
 
-	buffer.remove(0, int(it - buffer.constBegin()));
+	// sections of the previous generation are kept as long as they are repeated
+	it = previousSectionCache.find(key);
+	bool repeated = false;
+
+	if (it != previousSectionCache.end()) {
+		repeated = (*it == crc);
+		previousSectionCache.erase(it);
+	}
+
+	sectionCache.insert(key, crc);
+	return repeated;
 }
 
 class DvbDataDumper : public QFile, public DvbPidFilter
@@ -216,6 +363,7 @@ public:
 	~DvbDataDumper();
 
 	void processData(const char [188]);
+	void processPackets(const char *data, int count);
 };
 
 DvbDataDumper::DvbDataDumper()
@@ -237,10 +385,132 @@ void DvbDataDumper::processData(const char data[188])
 	write(data, 188);
 }
 
+void DvbDataDumper::processPackets(const char *data, int count)
+{
+	write(data, count * 188);
+}
+
+DvbDeviceDataPool::DvbDeviceDataPool(int bufferSize_, int bufferCount_, bool lockMemory) :
+	bufferSize(bufferSize_), bufferCount(bufferCount_), refCount(1), mapped(true),
+	nextBuffer(0), nextSpareBuffer(0)
+{
+	// each slab (back pointer + data) starts at a cache line
+	int slabSize = ((int(sizeof(DvbDeviceDataBuffer *)) + bufferSize + 63) & ~63);
+	memorySize = (size_t(slabSize) * size_t(bufferCount + 2));
+	memory = static_cast<char *>(mmap(NULL, memorySize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+	if (memory == MAP_FAILED) {
+		Log("DvbDeviceDataPool::DvbDeviceDataPool: mmap failed");
+		memory = new char[memorySize];
+		mapped = false;
+	} else {
+#ifdef MADV_HUGEPAGE
+		if (memorySize >= (2 * 1024 * 1024)) {
+			madvise(memory, memorySize, MADV_HUGEPAGE);
+		}
+#endif
+
+		if (lockMemory && (mlock(memory, memorySize) != 0)) {
+			Log("DvbDeviceDataPool::DvbDeviceDataPool: cannot lock buffers in memory") <<
+				qint64(memorySize);
+		}
+	}
+
+	buffers.reserve(bufferCount + 2);
+	returnedBuffers.reserve(bufferCount);
+
+	for (int i = 0; i < (bufferCount + 2); ++i) {
+		buffers.append(new DvbDeviceDataBuffer(this, memory + (i * slabSize), bufferSize));
+	}
+}
+
+DvbDeviceDataPool::~DvbDeviceDataPool()
+{
+	qDeleteAll(buffers);
+
+	if (mapped) {
+		munmap(memory, memorySize);
+	} else {
+		delete[] memory;
+	}
+}
+
+void DvbDeviceDataPool::release(DvbDeviceDataPool *pool)
+{
+	if (!pool->refCount.deref()) {
+		delete pool;
+	}
+}
+
+DvbDeviceDataBuffer *DvbDeviceDataPool::takeBuffer()
+{
+	DvbDeviceDataBuffer *buffer;
+
+	if (!returnedBuffers.isEmpty()) {
+		buffer = returnedBuffers.takeLast();
+	} else if (nextBuffer < bufferCount) {
+		buffer = buffers.at(nextBuffer);
+		++nextBuffer;
+	} else {
+		return NULL;
+	}
+
+	refCount.ref();
+	return buffer;
+}
+
+DvbDeviceDataBuffer *DvbDeviceDataPool::takeSpareBuffer()
+{
+	nextSpareBuffer ^= 1;
+	refCount.ref();
+	return buffers.at(bufferCount + nextSpareBuffer);
+}
+
+void DvbDeviceDataPool::returnBuffer(DvbDeviceDataBuffer *buffer)
+{
+	DvbDeviceDataPool *pool = buffer->pool;
+
+	if (!pool->isSpareBuffer(buffer)) {
+		pool->returnedBuffers.append(buffer);
+	}
+
+	release(pool);
+}
+
+class DvbDemuxThread : public QThread
+{
+public:
+	explicit DvbDemuxThread(DvbDevice *device_) : device(device_) { }
+	~DvbDemuxThread() { }
+
+private:
+	void run()
+	{
+		device->runDemuxThread();
+	}
+
+	DvbDevice *device;
+};
+
 DvbDevice::DvbDevice(DvbBackendDevice *backend_, QObject *parent) : QObject(parent),
-	backend(backend_), deviceState(DeviceReleased), dataDumper(NULL), cleanUpFilters(false),
-	isAuto(false), unusedBuffersHead(NULL), usedBuffersHead(NULL), usedBuffersTail(NULL)
+	backend(backend_), deviceState(DeviceReleased), dataDumper(NULL), isAuto(false),
+	usedBuffers(new DvbDeviceDataRing), unusedBuffers(new DvbDeviceDataRing),
+	dataPool(new DvbDeviceDataPool(DefaultBufferSize, DefaultBufferCount, false)),
+	pendingDataPool(NULL), bufferSize(DefaultBufferSize), bufferCount(DefaultBufferCount),
+	lockBuffers(false), exhaustedBuffers(0), droppedPackets(0), consumerWaiting(1), discardRequested(0),
+	stopDemuxThread(0), dataNotifier(NULL), demuxThread(NULL)
 {
+	memset(pidFilters, 0, sizeof(pidFilters));
+	dataEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (dataEventFd < 0) {
+		Log("DvbDevice::DvbDevice: cannot create eventfd");
+	} else {
+		dataNotifier = new QSocketNotifier(dataEventFd, QSocketNotifier::Read, this);
+		connect(dataNotifier, SIGNAL(activated(int)), this, SLOT(dataAvailable()));
+	}
+
 	backend->setFrontendDevice(this);
 	backend->setDeviceEnabled(true); // FIXME
 
@@ -250,17 +520,35 @@ DvbDevice::DvbDevice(DvbBackendDevice *backend_, QObject *parent) : QObject(pare
 DvbDevice::~DvbDevice()
 {
 	backend->release();
+	setDemuxThreadEnabled(false);
+
+	for (int pid = 0; pid < 8192; ++pid) {
+		delete pidFilters[pid];
+	}
+
+	DvbDeviceDataBuffer *buffer;
+
+	while ((buffer = usedBuffers->pop()) != NULL) {
+		DvbDeviceDataPool::returnBuffer(buffer);
+	}
+
+	while ((buffer = unusedBuffers->pop()) != NULL) {
+		DvbDeviceDataPool::returnBuffer(buffer);
+	}
+
+	DvbDeviceDataPool::release(dataPool);
+	DvbDeviceDataPool *pool = pendingDataPool.fetchAndStoreOrdered(NULL);
 
-	for (DvbDeviceDataBuffer *buffer = unusedBuffersHead; buffer != NULL;) {
-		DvbDeviceDataBuffer *nextBuffer = buffer->next;
-		delete buffer;
-		buffer = nextBuffer;
+	if (pool != NULL) {
+		DvbDeviceDataPool::release(pool);
 	}
 
-	for (DvbDeviceDataBuffer *buffer = usedBuffersHead; buffer != NULL;) {
-		DvbDeviceDataBuffer *nextBuffer = buffer->next;
-		delete buffer;
-		buffer = nextBuffer;
+	delete usedBuffers;
+	delete unusedBuffers;
+	delete dataNotifier;
+
+	if (dataEventFd >= 0) {
+		close(dataEventFd);
 	}
 }
 
@@ -279,6 +567,31 @@ QString DvbDevice::getFrontendName() const
 	return backend->getFrontendName();
 }
 
+int DvbDevice::getExhaustedBufferCount() const
+{
+	return exhaustedBuffers.load();
+}
+
+qint64 DvbDevice::getDroppedBytes() const
+{
+	return (qint64(droppedPackets.load()) * 188);
+}
+
+int DvbDevice::getSyncLossCount() const
+{
+	return backend->getSyncLossCount();
+}
+
+int DvbDevice::getTransportErrorCount() const
+{
+	return backend->getTransportErrorCount();
+}
+
+qint64 DvbDevice::getSkippedBytes() const
+{
+	return backend->getSkippedBytes();
+}
+
 void DvbDevice::tune(const DvbTransponder &transponder)
 {
 	DvbTransponderBase::TransmissionType transmissionType = transponder.getTransmissionType();
@@ -476,31 +789,36 @@ void DvbDevice::autoTune(const DvbTransponder &transponder)
 
 bool DvbDevice::addPidFilter(int pid, DvbPidFilter *filter)
 {
-	QMap<int, DvbFilterInternal>::iterator it = filters.find(pid);
-
-	if (it == filters.end()) {
-		it = filters.insert(pid, DvbFilterInternal());
-
-		if (dataDumper != NULL) {
-			it->filters.append(dataDumper);
-		}
+	if ((pid < 0) || (pid >= 8192)) {
+		Log("DvbDevice::addPidFilter: invalid pid") << pid;
+		return false;
 	}
 
-	if (it->activeFilters == 0) {
+	QMutexLocker locker(&filterMutex);
+	DvbFilterInternal *filterInternal = pidFilters[pid];
+
+	if (filterInternal == NULL) {
 		if (!backend->addPidFilter(pid)) {
-			cleanUpFilters = true;
 			return false;
 		}
+
+		filterInternal = new DvbFilterInternal();
+
+		if (dataDumper != NULL) {
+			filterInternal->filters.append(dataDumper);
+		}
+
+		pidFilters[pid] = filterInternal;
 	}
 
-	if (it->filters.contains(filter)) {
+	if (filterInternal->filters.contains(filter)) {
 		Log("DvbDevice::addPidFilter: "
 		    "using the same filter for the same pid more than once");
 		return true;
 	}
 
-	it->filters.append(filter);
-	++it->activeFilters;
+	filterInternal->filters.append(filter);
+	++filterInternal->activeFilters;
 	return true;
 }
 
@@ -509,12 +827,10 @@ bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter)
 	QMap<int, DvbSectionFilterInternal>::iterator it = sectionFilters.find(pid);
 
 	if (it == sectionFilters.end()) {
-		it = sectionFilters.insert(pid, DvbSectionFilterInternal());
-	}
+		it = sectionFilters.insert(pid, DvbSectionFilterInternal(this, pid));
 
-	if (it->activeSectionFilters == 0) {
 		if (!addPidFilter(pid, &(*it))) {
-			cleanUpFilters = true;
+			sectionFilters.erase(it);
 			return false;
 		}
 	}
@@ -525,20 +841,23 @@ bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter)
 		return true;
 	}
 
-	it->sectionFilters.append(filter);
-	++it->activeSectionFilters;
+	it->addSectionFilter(filter);
 	return true;
 }
 
 void DvbDevice::removePidFilter(int pid, DvbPidFilter *filter)
 {
-	QMap<int, DvbFilterInternal>::iterator it = filters.find(pid);
-	int index;
+	// once the lock is acquired, the filter isn't in use anymore
+	QMutexLocker locker(&filterMutex);
+	DvbFilterInternal *filterInternal = NULL;
+	int index = -1;
 
-	if (it != filters.end()) {
-		index = it->filters.indexOf(filter);
-	} else {
-		index = -1;
+	if ((pid >= 0) && (pid < 8192)) {
+		filterInternal = pidFilters[pid];
+	}
+
+	if (filterInternal != NULL) {
+		index = filterInternal->filters.indexOf(filter);
 	}
 
 	if (index < 0) {
@@ -546,14 +865,14 @@ void DvbDevice::removePidFilter(int pid, DvbPidFilter *filter)
 		return;
 	}
 
-	it->filters.replace(index, &dummyPidFilter);
-	--it->activeFilters;
+	filterInternal->filters.removeAt(index);
+	--filterInternal->activeFilters;
 
-	if (it->activeFilters == 0) {
+	if (filterInternal->activeFilters == 0) {
 		backend->removePidFilter(pid);
+		pidFilters[pid] = NULL;
+		delete filterInternal;
 	}
-
-	cleanUpFilters = true;
 }
 
 void DvbDevice::removeSectionFilter(int pid, DvbSectionFilter *filter)
@@ -572,14 +891,12 @@ void DvbDevice::removeSectionFilter(int pid, DvbSectionFilter *filter)
 		return;
 	}
 
-	it->sectionFilters.replace(index, &dummySectionFilter);
-	--it->activeSectionFilters;
+	it->removeSectionFilter(filter);
 
-	if (it->activeSectionFilters == 0) {
+	if (it->sectionFilters.isEmpty()) {
 		removePidFilter(pid, &(*it));
+		sectionFilters.erase(it);
 	}
-
-	cleanUpFilters = true;
 }
 
 void DvbDevice::startDescrambling(const QByteArray &pmtSectionData, QObject *user)
@@ -671,6 +988,11 @@ void DvbDevice::release()
 	setDeviceState(DeviceReleased);
 	stop();
 	backend->release();
+
+	if (getDroppedBytes() != 0) {
+		Log("DvbDevice::release: buffers exhausted") << getExhaustedBufferCount() <<
+			"dropped bytes" << getDroppedBytes();
+	}
 }
 
 void DvbDevice::enableDvbDump()
@@ -680,12 +1002,66 @@ void DvbDevice::enableDvbDump()
 	}
 
 	dataDumper = new DvbDataDumper();
+	QMutexLocker locker(&filterMutex);
 
-	QMap<int, DvbFilterInternal>::iterator it = filters.begin();
-	QMap<int, DvbFilterInternal>::iterator end = filters.end();
+	for (int pid = 0; pid < 8192; ++pid) {
+		if (pidFilters[pid] != NULL) {
+			pidFilters[pid]->filters.append(dataDumper);
+		}
+	}
+}
+
+void DvbDevice::setDemuxThreadEnabled(bool enabled)
+{
+	if (enabled == (demuxThread != NULL)) {
+		return;
+	}
 
-	for (; it != end; ++it) {
-		it->filters.append(dataDumper);
+	if (dataEventFd < 0) {
+		return;
+	}
+
+	// only one thread at a time may consume the buffers
+
+	if (enabled) {
+		dataNotifier->setEnabled(false);
+		stopDemuxThread.storeRelease(0);
+		demuxThread = new DvbDemuxThread(this);
+		demuxThread->start();
+	} else {
+		stopDemuxThread.storeRelease(1);
+		wakeUpConsumer();
+		demuxThread->wait();
+		delete demuxThread;
+		demuxThread = NULL;
+		dataNotifier->setEnabled(true);
+
+		// process the remaining buffers in this thread
+		wakeUpConsumer();
+	}
+}
+
+void DvbDevice::setDataBuffers(int bufferSize_, int bufferCount_, bool lockBuffers_)
+{
+	int newBufferSize = ((qBound(int(MinimumBufferSize), bufferSize_, int(MaximumBufferSize)) /
+		188) * 188);
+	int newBufferCount = qBound(int(MinimumBufferCount), bufferCount_, int(MaximumBufferCount));
+
+	if ((bufferSize == newBufferSize) && (bufferCount == newBufferCount) &&
+	    (lockBuffers == lockBuffers_)) {
+		return;
+	}
+
+	bufferSize = newBufferSize;
+	bufferCount = newBufferCount;
+	lockBuffers = lockBuffers_;
+
+	// the backend thread switches to the new pool (see getBuffer())
+	DvbDeviceDataPool *pool = pendingDataPool.fetchAndStoreOrdered(
+		new DvbDeviceDataPool(bufferSize, bufferCount, lockBuffers));
+
+	if (pool != NULL) {
+		DvbDeviceDataPool::release(pool);
 	}
 }
 
@@ -830,20 +1206,8 @@ void DvbDevice::setDeviceState(DeviceState newState)
 
 void DvbDevice::discardBuffers()
 {
-	dataChannelMutex.lock();
-
-	if (usedBuffersHead != NULL) {
-		usedBuffersHead->size = 0;
-		DvbDeviceDataBuffer *nextBuffer = usedBuffersHead->next;
-		usedBuffersHead->next = NULL;
-
-		if (nextBuffer != NULL) {
-			nextBuffer->next = unusedBuffersHead;
-			unusedBuffersHead = nextBuffer;
-		}
-	}
-
-	dataChannelMutex.unlock();
+	// the consumer of the buffers takes care of it
+	discardRequested.storeRelease(1);
 }
 
 void DvbDevice::stop()
@@ -851,131 +1215,184 @@ void DvbDevice::stop()
 	isAuto = false;
 	frontendTimer.stop();
 
-	for (QMap<int, DvbFilterInternal>::ConstIterator it = filters.constBegin();
-	     it != filters.constEnd(); ++it) {
-		foreach (DvbPidFilter *filter, it->filters) {
-			if ((filter != &dummyPidFilter) && (filter != dataDumper)) {
-				int pid = it.key();
-				Log("DvbDevice::stop: removing pending filter") << pid;
-				removePidFilter(pid, filter);
-			}
-		}
-	}
+	QList<QPair<int, DvbSectionFilter *> > pendingSectionFilters;
 
 	for (QMap<int, DvbSectionFilterInternal>::ConstIterator it = sectionFilters.constBegin();
 	     it != sectionFilters.constEnd(); ++it) {
 		foreach (DvbSectionFilter *sectionFilter, it->sectionFilters) {
-			if (sectionFilter != &dummySectionFilter) {
-				int pid = it.key();
-				Log("DvbDevice::stop: removing pending filter") << pid;
-				removeSectionFilter(pid, sectionFilter);
+			pendingSectionFilters.append(qMakePair(it.key(), sectionFilter));
+		}
+	}
+
+	for (int i = 0; i < pendingSectionFilters.size(); ++i) {
+		int pid = pendingSectionFilters.at(i).first;
+		Log("DvbDevice::stop: removing pending filter") << pid;
+		removeSectionFilter(pid, pendingSectionFilters.at(i).second);
+	}
+
+	QList<QPair<int, DvbPidFilter *> > pendingFilters;
+
+	for (int pid = 0; pid < 8192; ++pid) {
+		if (pidFilters[pid] == NULL) {
+			continue;
+		}
+
+		foreach (DvbPidFilter *filter, pidFilters[pid]->filters) {
+			if (filter != dataDumper) {
+				pendingFilters.append(qMakePair(pid, filter));
 			}
 		}
 	}
+
+	for (int i = 0; i < pendingFilters.size(); ++i) {
+		int pid = pendingFilters.at(i).first;
+		Log("DvbDevice::stop: removing pending filter") << pid;
+		removePidFilter(pid, pendingFilters.at(i).second);
+	}
 }
 
 DvbDataBuffer DvbDevice::getBuffer()
 {
-	dataChannelMutex.lock();
-	DvbDeviceDataBuffer *buffer = unusedBuffersHead;
+	DvbDeviceDataPool *newPool = pendingDataPool.fetchAndStoreOrdered(NULL);
 
-	if (buffer != NULL) {
-		unusedBuffersHead = buffer->next;
-		dataChannelMutex.unlock();
-	} else {
-		dataChannelMutex.unlock();
-		buffer = new DvbDeviceDataBuffer;
+	if (newPool != NULL) {
+		DvbDeviceDataPool::release(dataPool);
+		dataPool = newPool;
+	}
+
+	DvbDeviceDataBuffer *buffer;
+
+	while ((buffer = unusedBuffers->pop()) != NULL) {
+		if (buffer->pool == dataPool) {
+			break;
+		}
+
+		// the buffer settings have been changed in the meantime
+		DvbDeviceDataPool::returnBuffer(buffer);
 	}
 
-	return DvbDataBuffer(buffer->data, sizeof(buffer->data));
+	if (buffer == NULL) {
+		buffer = dataPool->takeBuffer();
+	}
+
+	if (buffer == NULL) {
+		// the consumer doesn't keep up; drop the data instead of allocating more memory
+		exhaustedBuffers.ref();
+		buffer = dataPool->takeSpareBuffer();
+	}
+
+	return DvbDataBuffer(buffer->data, buffer->bufferSize);
 }
 
 void DvbDevice::writeBuffer(const DvbDataBuffer &dataBuffer)
 {
-	DvbDeviceDataBuffer *buffer = reinterpret_cast<DvbDeviceDataBuffer *>(dataBuffer.data);
+	DvbDeviceDataBuffer *buffer = DvbDeviceDataBuffer::fromData(dataBuffer.data);
 	Q_ASSERT(buffer->data == dataBuffer.data);
 
-	if (dataBuffer.dataSize > 0) {
-		buffer->size = dataBuffer.dataSize;
-		dataChannelMutex.lock();
-		bool wakeUp = false;
+	if (dataBuffer.dataSize <= 0) {
+		// the buffer is handed back unused
+		DvbDeviceDataPool::returnBuffer(buffer);
+		return;
+	}
 
-		if (usedBuffersHead != NULL) {
-			usedBuffersTail->next = buffer;
-		} else {
-			usedBuffersHead = buffer;
-			wakeUp = true;
-		}
+	buffer->size = dataBuffer.dataSize;
 
-		usedBuffersTail = buffer;
-		usedBuffersTail->next = NULL;
-		dataChannelMutex.unlock();
+	if (buffer->pool->isSpareBuffer(buffer) || !usedBuffers->push(buffer)) {
+		droppedPackets.fetchAndAddRelaxed(dataBuffer.dataSize / 188);
+		DvbDeviceDataPool::returnBuffer(buffer);
+		return;
+	}
 
-		if (wakeUp) {
-			QCoreApplication::postEvent(this, new QEvent(QEvent::User));
-		}
-	} else {
-		dataChannelMutex.lock();
-		buffer->next = unusedBuffersHead;
-		unusedBuffersHead = buffer;
-		dataChannelMutex.unlock();
+	// only wake up the consumer if it has run out of buffers
+
+	if (consumerWaiting.fetchAndStoreOrdered(0) != 0) {
+		wakeUpConsumer();
 	}
 }
 
 void DvbDevice::customEvent(QEvent *)
 {
-	if (cleanUpFilters) {
-		cleanUpFilters = false;
+	processSections();
+}
+
+void DvbDevice::dataAvailable()
+{
+	quint64 value;
 
-		{
-			QMap<int, DvbFilterInternal>::iterator it = filters.begin();
-			QMap<int, DvbFilterInternal>::iterator end = filters.end();
+	if ((read(dataEventFd, &value, sizeof(value)) < 0) && (errno != EAGAIN)) {
+		Log("DvbDevice::dataAvailable: cannot read from eventfd");
+	}
 
-			while (it != end) {
-				if (it->activeFilters == 0) {
-					it = filters.erase(it);
-				} else {
-					it->filters.removeAll(&dummyPidFilter);
-					++it;
-				}
+	processBuffers();
+	processSections();
+}
+
+void DvbDevice::runDemuxThread()
+{
+	pollfd pollFd;
+	memset(&pollFd, 0, sizeof(pollFd));
+	pollFd.fd = dataEventFd;
+	pollFd.events = POLLIN;
+
+	while (stopDemuxThread.loadAcquire() == 0) {
+		processBuffers();
+
+		if (poll(&pollFd, 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
 			}
+
+			Log("DvbDevice::runDemuxThread: poll failed");
+			break;
 		}
 
-		{
-			QMap<int, DvbSectionFilterInternal>::iterator it = sectionFilters.begin();
-			QMap<int, DvbSectionFilterInternal>::iterator end = sectionFilters.end();
+		quint64 value;
 
-			while (it != end) {
-				if (it->activeSectionFilters == 0) {
-					it = sectionFilters.erase(it);
-				} else {
-					it->sectionFilters.removeAll(&dummySectionFilter);
-					++it;
-				}
-			}
+		if ((read(dataEventFd, &value, sizeof(value)) < 0) && (errno != EAGAIN)) {
+			Log("DvbDevice::runDemuxThread: cannot read from eventfd");
 		}
 	}
+}
 
-	DvbDeviceDataBuffer *buffer = NULL;
+void DvbDevice::wakeUpConsumer()
+{
+	quint64 value = 1;
 
+	if ((write(dataEventFd, &value, sizeof(value)) < 0) && (errno != EAGAIN)) {
+		Log("DvbDevice::wakeUpConsumer: cannot write to eventfd");
+	}
+}
+
+void DvbDevice::processBuffers()
+{
 	while (true) {
-		dataChannelMutex.lock();
+		DvbDeviceDataBuffer *buffer;
 
-		if (buffer != NULL) {
-			usedBuffersHead = buffer->next;
-			buffer->next = unusedBuffersHead;
-			unusedBuffersHead = buffer;
+		if (discardRequested.fetchAndStoreOrdered(0) != 0) {
+			while ((buffer = usedBuffers->pop()) != NULL) {
+				recycleBuffer(buffer);
+			}
 		}
 
-		buffer = usedBuffersHead;
-		dataChannelMutex.unlock();
+		buffer = usedBuffers->pop();
 
 		if (buffer == NULL) {
-			break;
+			// announce the wait first, then check again to avoid a lost wake-up
+			consumerWaiting.fetchAndStoreOrdered(1);
+
+			if (usedBuffers->isEmpty()) {
+				break;
+			}
+
+			continue;
 		}
 
-		for (int i = 0; i < buffer->size; i += 188) {
-			char *packet = (buffer->data + i);
+		filterMutex.lock();
+		int i = 0;
+
+		while (i < buffer->size) {
+			const char *packet = (buffer->data + i);
+			i += 188;
 
 			if ((packet[1] & 0x80) != 0) {
 				// transport error indicator
@@ -985,18 +1402,118 @@ void DvbDevice::customEvent(QEvent *)
 			int pid = ((static_cast<unsigned char>(packet[1]) << 8) |
 				static_cast<unsigned char>(packet[2])) & ((1 << 13) - 1);
 
-			QMap<int, DvbFilterInternal>::const_iterator it = filters.constFind(pid);
+			const DvbFilterInternal *filterInternal = pidFilters[pid];
 
-			if (it == filters.constEnd()) {
+			if (filterInternal == NULL) {
 				continue;
 			}
 
-			const QList<DvbPidFilter *> &pidFilters = it->filters;
-			int pidFiltersSize = pidFilters.size();
+			// collect the following packets with the same pid (and without errors)
+			int count = 1;
+
+			while (i < buffer->size) {
+				const char *nextPacket = (buffer->data + i);
+
+				if (((nextPacket[1] & 0x80) != 0) || (nextPacket[1] != packet[1]) ||
+				    (nextPacket[2] != packet[2])) {
+					break;
+				}
+
+				++count;
+				i += 188;
+			}
+
+			const QList<DvbPidFilter *> &filters = filterInternal->filters;
+			int filtersSize = filters.size();
 
-			for (int j = 0; j < pidFiltersSize; ++j) {
-				pidFilters.at(j)->processData(packet);
+			if (count == 1) {
+				for (int j = 0; j < filtersSize; ++j) {
+					filters.at(j)->processData(packet);
+				}
+			} else {
+				for (int j = 0; j < filtersSize; ++j) {
+					filters.at(j)->processPackets(packet, count);
+				}
 			}
 		}
+
+		filterMutex.unlock();
+
+		// the section filters may change the filters, so they are called without
+		// filterMutex; the sections may still refer to the buffer
+		for (int j = 0; j < directSections.size(); ++j) {
+			processSection(directSections.at(j));
+		}
+
+		// keeps the capacity
+		directSections.resize(0);
+		recycleBuffer(buffer);
+	}
+}
+
+void DvbDevice::recycleBuffer(DvbDeviceDataBuffer *buffer)
+{
+	if (!unusedBuffers->push(buffer)) {
+		// can't happen with the current limits; the buffer is lost for the pool
+		DvbDeviceDataPool::release(buffer->pool);
+	}
+}
+
+void DvbDevice::queueSection(int pid, const char *data, int size, bool repeated, bool inPlace)
+{
+	if (demuxThread == NULL) {
+		// processBuffers() runs in the thread owning the device
+		if (inPlace) {
+			directSections.append(DvbPendingSection(pid, repeated, data, size));
+		} else {
+			directSections.append(DvbPendingSection(pid, repeated, QByteArray(data, size)));
+		}
+
+		return;
+	}
+
+	sectionMutex.lock();
+	bool wakeUp = pendingSections.isEmpty();
+	pendingSections.append(DvbPendingSection(pid, repeated, QByteArray(data, size)));
+	sectionMutex.unlock();
+
+	if (wakeUp) {
+		QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+	}
+}
+
+void DvbDevice::processSections()
+{
+	sectionMutex.lock();
+	QList<DvbPendingSection> sections = pendingSections;
+	pendingSections.clear();
+	sectionMutex.unlock();
+
+	for (int i = 0; i < sections.size(); ++i) {
+		processSection(sections.at(i));
+	}
+}
+
+void DvbDevice::processSection(const DvbPendingSection &section)
+{
+	int pid = section.pid;
+	QMap<int, DvbSectionFilterInternal>::ConstIterator it = sectionFilters.constFind(pid);
+
+	if (it == sectionFilters.constEnd()) {
+		return;
+	}
+
+	// section filters may be added or removed while processing the section
+	QList<DvbSectionFilter *> currentSectionFilters = it->sectionFilters;
+
+	for (int j = 0; j < currentSectionFilters.size(); ++j) {
+		DvbSectionFilter *sectionFilter = currentSectionFilters.at(j);
+		it = sectionFilters.constFind(pid);
+
+		if ((it != sectionFilters.constEnd()) &&
+		    it->sectionFilters.contains(sectionFilter) &&
+		    (!section.repeated || !sectionFilter->isChangesOnly())) {
+			sectionFilter->processSection(section.constData(), section.size());
+		}
 	}
 }
@@ -21,35 +21,53 @@
 #ifndef DVBDEVICE_H
 #define DVBDEVICE_H
 
+#include <QAtomicInt>
+#include <QAtomicPointer>
 #include <QExplicitlySharedDataPointer>
 #include <QMap>
 #include <QMutex>
+#include <QPair>
 #include <QTimer>
+#include <QVector>
 #include "dvbbackenddevice.h"
 #include "dvbtransponder.h"
 
+class QSocketNotifier;
 class DvbConfigBase;
 class DvbDataDumper;
+class DvbDemuxThread;
 class DvbDeviceDataBuffer;
+class DvbDeviceDataPool;
+class DvbDeviceDataRing;
 class DvbFilterInternal;
 class DvbSectionFilterInternal;
 
-class DvbDummyPidFilter : public DvbPidFilter
+class DvbPendingSection
 {
 public:
-	DvbDummyPidFilter() { }
-	~DvbDummyPidFilter() { }
-
-	void processData(const char [188]) { }
-};
+	DvbPendingSection() : pid(-1), repeated(false), sectionData(NULL), sectionSize(0) { }
+	DvbPendingSection(int pid_, bool repeated_, const QByteArray &data_) : pid(pid_),
+		repeated(repeated_), data(data_), sectionData(NULL), sectionSize(0) { }
+	// refers to a data buffer; only valid until the buffer is recycled
+	DvbPendingSection(int pid_, bool repeated_, const char *sectionData_, int sectionSize_) :
+		pid(pid_), repeated(repeated_), sectionData(sectionData_), sectionSize(sectionSize_) { }
+	~DvbPendingSection() { }
+
+	const char *constData() const
+	{
+		return (sectionData != NULL) ? sectionData : data.constData();
+	}
 
-class DvbDummySectionFilter : public DvbSectionFilter
-{
-public:
-	DvbDummySectionFilter() { }
-	~DvbDummySectionFilter() { }
+	int size() const
+	{
+		return (sectionData != NULL) ? sectionSize : data.size();
+	}
 
-	void processSection(const char *, int) { }
+	int pid;
+	bool repeated; // unchanged repetition (skipped for "changes only" section filters)
+	QByteArray data;
+	const char *sectionData;
+	int sectionSize;
 };
 
 // FIXME make DvbDevice shared ...
@@ -67,6 +85,20 @@ public:
 		// FIXME introduce a TuningFailed state
 	};
 
+	// size of the data buffers handed to the backend (multiple of 188)
+	enum {
+		MinimumBufferSize = 5 * 188,
+		DefaultBufferSize = 348 * 188, // ~ 64 KiB
+		MaximumBufferSize = 11155 * 188 // ~ 2 MiB
+	};
+
+	// number of preallocated data buffers
+	enum {
+		MinimumBufferCount = 4,
+		DefaultBufferCount = 64,
+		MaximumBufferCount = 255
+	};
+
 	DvbDevice(DvbBackendDevice *backend_, QObject *parent);
 	~DvbDevice();
 
@@ -84,6 +116,15 @@ public:
 	QString getDeviceId() const;
 	QString getFrontendName() const;
 
+	// overload statistics (the data of exhausted buffers is dropped)
+	int getExhaustedBufferCount() const;
+	qint64 getDroppedBytes() const;
+
+	// corruption statistics of the received stream
+	int getSyncLossCount() const;
+	int getTransportErrorCount() const;
+	qint64 getSkippedBytes() const;
+
 	void tune(const DvbTransponder &transponder);
 	void autoTune(const DvbTransponder &transponder);
 	bool addPidFilter(int pid, DvbPidFilter *filter);
@@ -105,45 +146,73 @@ public:
 	void reacquire(const DvbConfigBase *config_);
 	void release();
 	void enableDvbDump();
+	// takes effect for newly requested buffers
+	void setDataBuffers(int bufferSize_, int bufferCount_, bool lockBuffers_);
+	void setDemuxThreadEnabled(bool enabled);
 
 signals:
 	void stateChanged();
 
 private slots:
 	void frontendEvent();
+	void dataAvailable();
 
 private:
+	friend class DvbDemuxThread;
+	friend class DvbSectionFilterInternal;
+
 	void setDeviceState(DeviceState newState);
 	void discardBuffers();
 	void stop();
 
-	void processData(const char data[188]);
 	DvbDataBuffer getBuffer();
 	void writeBuffer(const DvbDataBuffer &dataBuffer);
 	void customEvent(QEvent *);
 
+	void runDemuxThread();
+	void wakeUpConsumer();
+	void processBuffers();
+	void recycleBuffer(DvbDeviceDataBuffer *buffer);
+	void queueSection(int pid, const char *data, int size, bool repeated, bool inPlace);
+	void processSections();
+	void processSection(const DvbPendingSection &section);
+
 	DvbBackendDevice *backend;
 	DeviceState deviceState;
 	QExplicitlySharedDataPointer<const DvbConfigBase> config;
 
 	int frontendTimeout;
 	QTimer frontendTimer;
-	QMap<int, DvbFilterInternal> filters;
+	DvbFilterInternal *pidFilters[8192]; // indexed by pid; modified under filterMutex
 	QMap<int, DvbSectionFilterInternal> sectionFilters;
-	DvbDummyPidFilter dummyPidFilter;
-	DvbDummySectionFilter dummySectionFilter;
 	DvbDataDumper *dataDumper;
-	bool cleanUpFilters;
+	QMutex filterMutex;
+	QList<DvbPendingSection> pendingSections; // only used with the demux thread
+	QMutex sectionMutex;
+	QVector<DvbPendingSection> directSections; // delivered by processBuffers()
 	QMultiMap<int, QObject *> descramblingServices;
 
 	bool isAuto;
 	DvbTransponder autoTransponder;
 	Capabilities capabilities;
 
-	DvbDeviceDataBuffer *unusedBuffersHead;
-	DvbDeviceDataBuffer *usedBuffersHead;
-	DvbDeviceDataBuffer *usedBuffersTail;
-	QMutex dataChannelMutex;
+	// the backend thread produces buffers, which are consumed either by the thread
+	// owning the device or by the demux thread; no locks are involved
+	DvbDeviceDataRing *usedBuffers;
+	DvbDeviceDataRing *unusedBuffers;
+	DvbDeviceDataPool *dataPool; // only accessed by the backend thread
+	QAtomicPointer<DvbDeviceDataPool> pendingDataPool;
+	int bufferSize;
+	int bufferCount;
+	bool lockBuffers;
+	QAtomicInt exhaustedBuffers;
+	QAtomicInt droppedPackets;
+	QAtomicInt consumerWaiting;
+	QAtomicInt discardRequested;
+	QAtomicInt stopDemuxThread;
+	int dataEventFd;
+	QSocketNotifier *dataNotifier;
+	DvbDemuxThread *demuxThread;
 };
 
 #endif /* DVBDEVICE_H */
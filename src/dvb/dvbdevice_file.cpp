@@ -0,0 +1,422 @@
+/*
+ * dvbdevice_file.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbdevice_file.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <cstring>
+#include "../log.h"
+
+DvbFileDevice::DvbFileDevice(QObject *parent, const QString &deviceId_,
+	const QList<QPair<DvbTransponder, QString> > &transponders_, bool paced_) :
+	QThread(parent), deviceId(deviceId_), transponders(transponders_), paced(paced_),
+	frontend(NULL), stopRequested(false), pidCount(0)
+{
+	memset(pids, 0, sizeof(pids));
+
+	for (int i = 0; i < transponders.size(); ++i) {
+		// the values of both enums correspond to each other
+		transmissionTypes |=
+			TransmissionType(1 << transponders.at(i).first.getTransmissionType());
+	}
+}
+
+DvbFileDevice::~DvbFileDevice()
+{
+	release();
+}
+
+QString DvbFileDevice::getDeviceId()
+{
+	return deviceId;
+}
+
+QString DvbFileDevice::getFrontendName()
+{
+	return QLatin1String("Kaffeine Virtual Tuner");
+}
+
+DvbFileDevice::TransmissionTypes DvbFileDevice::getTransmissionTypes()
+{
+	return transmissionTypes;
+}
+
+DvbFileDevice::Capabilities DvbFileDevice::getCapabilities()
+{
+	Capabilities capabilities = DvbTModulationAuto;
+	capabilities |= DvbTFecAuto;
+	capabilities |= DvbTTransmissionModeAuto;
+	capabilities |= DvbTGuardIntervalAuto;
+	return capabilities;
+}
+
+void DvbFileDevice::setFrontendDevice(DvbFrontendDevice *frontend_)
+{
+	frontend = frontend_;
+}
+
+void DvbFileDevice::setDeviceEnabled(bool enabled_)
+{
+	if (!enabled_) {
+		release();
+	}
+}
+
+bool DvbFileDevice::acquire()
+{
+	return true;
+}
+
+bool DvbFileDevice::setTone(SecTone tone)
+{
+	Q_UNUSED(tone)
+	return true;
+}
+
+bool DvbFileDevice::setVoltage(SecVoltage voltage)
+{
+	Q_UNUSED(voltage)
+	return true;
+}
+
+bool DvbFileDevice::sendMessage(const char *message, int length)
+{
+	Q_UNUSED(message)
+	Q_UNUSED(length)
+	return true;
+}
+
+bool DvbFileDevice::sendBurst(SecBurst burst)
+{
+	Q_UNUSED(burst)
+	return true;
+}
+
+bool DvbFileDevice::tune(const DvbTransponder &transponder)
+{
+	stopReplay();
+	file.close();
+
+	for (int i = 0; i < transponders.size(); ++i) {
+		if (transponders.at(i).first.corresponds(transponder)) {
+			file.setFileName(transponders.at(i).second);
+
+			if (!file.open(QIODevice::ReadOnly)) {
+				Log("DvbFileDevice::tune: cannot open") << file.fileName();
+				return false;
+			}
+
+			startReplay();
+			return true;
+		}
+	}
+
+	Log("DvbFileDevice::tune: no file for transponder") << transponder.toString();
+	return false;
+}
+
+bool DvbFileDevice::isTuned()
+{
+	return file.isOpen();
+}
+
+int DvbFileDevice::getSignal()
+{
+	return (file.isOpen() ? 100 : 0);
+}
+
+int DvbFileDevice::getSnr()
+{
+	return -1;
+}
+
+// the file is passed on as it is
+
+int DvbFileDevice::getSyncLossCount()
+{
+	return 0;
+}
+
+int DvbFileDevice::getTransportErrorCount()
+{
+	return 0;
+}
+
+qint64 DvbFileDevice::getSkippedBytes()
+{
+	return 0;
+}
+
+bool DvbFileDevice::addPidFilter(int pid)
+{
+	QMutexLocker locker(&mutex);
+
+	if (pids[pid]) {
+		Log("DvbFileDevice::addPidFilter: pid filter already set up for pid") << pid;
+		return false;
+	}
+
+	pids[pid] = true;
+	++pidCount;
+	condition.wakeAll();
+	return true;
+}
+
+void DvbFileDevice::removePidFilter(int pid)
+{
+	QMutexLocker locker(&mutex);
+
+	if (!pids[pid]) {
+		Log("DvbFileDevice::removePidFilter: no pid filter set up for pid") << pid;
+		return;
+	}
+
+	pids[pid] = false;
+	--pidCount;
+}
+
+void DvbFileDevice::startDescrambling(const QByteArray &pmtSectionData)
+{
+	Q_UNUSED(pmtSectionData)
+}
+
+void DvbFileDevice::stopDescrambling(int serviceId)
+{
+	Q_UNUSED(serviceId)
+}
+
+void DvbFileDevice::release()
+{
+	stopReplay();
+	file.close();
+
+	QMutexLocker locker(&mutex);
+	memset(pids, 0, sizeof(pids));
+	pidCount = 0;
+}
+
+void DvbFileDevice::startReplay()
+{
+	Q_ASSERT(file.isOpen() && !isRunning());
+	mutex.lock();
+	stopRequested = false;
+	mutex.unlock();
+	start();
+}
+
+void DvbFileDevice::stopReplay()
+{
+	if (isRunning()) {
+		mutex.lock();
+		stopRequested = true;
+		condition.wakeAll();
+		mutex.unlock();
+		wait();
+	}
+}
+
+bool DvbFileDevice::waitForReplay(int msecs)
+{
+	QMutexLocker locker(&mutex);
+
+	if (!stopRequested) {
+		if (msecs >= 0) {
+			condition.wait(&mutex, msecs);
+		} else {
+			condition.wait(&mutex);
+		}
+	}
+
+	return !stopRequested;
+}
+
+void DvbFileDevice::run()
+{
+	DvbDataBuffer buffer = frontend->getBuffer();
+	buffer.dataSize = 0;
+	QByteArray readBuffer;
+	int readPos = 0;
+	bool activePids[8192];
+	int pcrPid = -1;
+	qint64 firstPcr = -1;
+	qint64 lastPcr = -1;
+	QElapsedTimer timer;
+
+	while (true) {
+		if ((readPos + 188) > readBuffer.size()) {
+			readBuffer = (readBuffer.mid(readPos) + file.read(348 * 188));
+			readPos = 0;
+
+			if (readBuffer.size() < 188) {
+				// start again from the beginning
+				if ((file.size() < 188) || !file.seek(0)) {
+					Log("DvbFileDevice::run: cannot replay") << file.fileName();
+					break;
+				}
+
+				readBuffer.clear();
+				firstPcr = -1;
+				continue;
+			}
+
+			// take a snapshot of the pid filters for the next packets
+			mutex.lock();
+
+			while ((pidCount == 0) && !stopRequested) {
+				condition.wait(&mutex);
+				firstPcr = -1;
+			}
+
+			bool stop = stopRequested;
+			memcpy(activePids, pids, sizeof(activePids));
+			mutex.unlock();
+
+			if (stop) {
+				break;
+			}
+		}
+
+		const unsigned char *packet =
+			reinterpret_cast<const unsigned char *>(readBuffer.constData() + readPos);
+
+		if (packet[0] != 0x47) {
+			// resynchronize
+			++readPos;
+			continue;
+		}
+
+		readPos += 188;
+		int pid = (((packet[1] << 8) | packet[2]) & ((1 << 13) - 1));
+
+		if (paced && ((packet[3] & 0x20) != 0) && (packet[4] >= 7) &&
+		    ((packet[5] & 0x10) != 0)) {
+			if (pcrPid < 0) {
+				pcrPid = pid;
+			}
+
+			if (pid == pcrPid) {
+				qint64 pcr = ((((qint64(packet[6]) << 25) | (packet[7] << 17) |
+					(packet[8] << 9) | (packet[9] << 1) | (packet[10] >> 7)) * 300) +
+					(((packet[10] & 0x01) << 8) | packet[11]));
+
+				if ((firstPcr < 0) || (pcr < lastPcr) ||
+				    ((pcr - lastPcr) > (10 * 27000000))) {
+					// start or discontinuity
+					firstPcr = pcr;
+					timer.start();
+				} else {
+					qint64 delay = (((pcr - firstPcr) / 27000) - timer.elapsed());
+
+					if (delay > 0) {
+						if (buffer.dataSize > 0) {
+							frontend->writeBuffer(buffer);
+							buffer = frontend->getBuffer();
+							buffer.dataSize = 0;
+						}
+
+						if (!waitForReplay(int(delay))) {
+							break;
+						}
+					}
+				}
+
+				lastPcr = pcr;
+			}
+		}
+
+		if (!activePids[pid]) {
+			continue;
+		}
+
+		memcpy(buffer.data + buffer.dataSize, packet, 188);
+		buffer.dataSize += 188;
+
+		if ((buffer.dataSize + 188) > buffer.bufferSize) {
+			frontend->writeBuffer(buffer);
+			buffer = frontend->getBuffer();
+			buffer.dataSize = 0;
+		}
+	}
+
+	buffer.dataSize = 0;
+	frontend->writeBuffer(buffer);
+}
+
+DvbFileDeviceManager::DvbFileDeviceManager(QObject *parent, const QString &folder_,
+	int deviceCount_, bool paced_) : QObject(parent), folder(folder_), deviceCount(deviceCount_),
+	paced(paced_)
+{
+}
+
+DvbFileDeviceManager::~DvbFileDeviceManager()
+{
+	qDeleteAll(devices);
+}
+
+void DvbFileDeviceManager::doColdPlug()
+{
+	QDir dir(folder);
+	QFile file(dir.filePath(QLatin1String("transponders.txt")));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		Log("DvbFileDeviceManager::doColdPlug: cannot open") << file.fileName();
+		return;
+	}
+
+	QList<QPair<DvbTransponder, QString> > transponders;
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+
+	while (!stream.atEnd()) {
+		QString line = stream.readLine();
+
+		if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+			continue;
+		}
+
+		int index = line.indexOf(QLatin1Char('\t'));
+		DvbTransponder transponder;
+
+		if (index > 0) {
+			transponder = DvbTransponder::fromString(line.mid(index + 1));
+		}
+
+		if (!transponder.isValid()) {
+			Log("DvbFileDeviceManager::doColdPlug: invalid line") << line;
+			continue;
+		}
+
+		transponders.append(qMakePair(transponder, dir.filePath(line.left(index))));
+	}
+
+	if (transponders.isEmpty()) {
+		Log("DvbFileDeviceManager::doColdPlug: no transponders in") << file.fileName();
+		return;
+	}
+
+	for (int i = 0; i < deviceCount; ++i) {
+		DvbFileDevice *device = new DvbFileDevice(this,
+			QLatin1String("V") + QString::number(i), transponders, paced);
+		devices.append(device);
+		emit deviceAdded(device);
+	}
+}
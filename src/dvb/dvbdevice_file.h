@@ -0,0 +1,116 @@
+/*
+ * dvbdevice_file.h
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBDEVICE_FILE_H
+#define DVBDEVICE_FILE_H
+
+#include <QFile>
+#include <QMutex>
+#include <QPair>
+#include <QThread>
+#include <QWaitCondition>
+#include "dvbbackenddevice.h"
+#include "dvbtransponder.h"
+
+// virtual tuner, which replays recorded transport streams (one file per transponder)
+
+class DvbFileDevice : public QThread, public DvbBackendDevice
+{
+public:
+	DvbFileDevice(QObject *parent, const QString &deviceId_,
+		const QList<QPair<DvbTransponder, QString> > &transponders_, bool paced_);
+	~DvbFileDevice();
+
+protected:
+	QString getDeviceId();
+	QString getFrontendName();
+	TransmissionTypes getTransmissionTypes();
+	Capabilities getCapabilities();
+	void setFrontendDevice(DvbFrontendDevice *frontend_);
+	void setDeviceEnabled(bool enabled_);
+	bool acquire();
+	bool setTone(SecTone tone);
+	bool setVoltage(SecVoltage voltage);
+	bool sendMessage(const char *message, int length);
+	bool sendBurst(SecBurst burst);
+	bool tune(const DvbTransponder &transponder); // discards obsolete data
+	bool isTuned();
+	int getSignal(); // 0 - 100 [%] or -1 = not supported
+	int getSnr(); // 0 - 100 [%] or -1 = not supported
+	int getSyncLossCount();
+	int getTransportErrorCount();
+	qint64 getSkippedBytes();
+	bool addPidFilter(int pid);
+	void removePidFilter(int pid);
+	void startDescrambling(const QByteArray &pmtSectionData);
+	void stopDescrambling(int serviceId);
+	void release();
+
+private:
+	void startReplay();
+	void stopReplay();
+	void run();
+	bool waitForReplay(int msecs); // returns false if the replay should stop
+
+	QString deviceId;
+	QList<QPair<DvbTransponder, QString> > transponders;
+	bool paced; // replay in real time (according to the pcr) or as fast as possible
+	TransmissionTypes transmissionTypes;
+	DvbFrontendDevice *frontend;
+	QFile file;
+
+	QMutex mutex; // protects the following members
+	QWaitCondition condition;
+	bool stopRequested;
+	int pidCount;
+	bool pids[8192];
+};
+
+/*
+ * the folder contains the transport streams and an index file called "transponders.txt";
+ * each line of the index consists of a file name, a tab and the transponder (linuxtv scan
+ * file format); note that dvb-s transponders have to be listed with their intermediate
+ * frequency, because that's what the backend gets to see
+ */
+
+class DvbFileDeviceManager : public QObject
+{
+	Q_OBJECT
+public:
+	DvbFileDeviceManager(QObject *parent, const QString &folder_, int deviceCount_,
+		bool paced_);
+	~DvbFileDeviceManager();
+
+public slots:
+	void doColdPlug();
+
+signals:
+	void requestBuiltinDeviceManager(QObject *&builtinDeviceManager);
+	void deviceAdded(DvbBackendDevice *device);
+	void deviceRemoved(DvbBackendDevice *device);
+
+private:
+	QString folder;
+	int deviceCount;
+	bool paced;
+	QList<DvbFileDevice *> devices;
+};
+
+#endif /* DVBDEVICE_FILE_H */
@@ -22,11 +22,16 @@
 
 #include <QFile>
 #include <QSocketNotifier>
+#include <cstring>
 #include <dmx.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <frontend.h>
 #include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include "../log.h"
@@ -36,8 +41,15 @@
 
 // krazy:excludeall=syscalls
 
+// default size of the dvr buffer in the kernel
+static const int defaultDvrKernelBufferSize = (10 * 188 * 1024);
+
 DvbLinuxDevice::DvbLinuxDevice(QObject *parent) : QThread(parent), ready(false), frontend(NULL),
-	enabled(false), frontendFd(-1), dvrFd(-1), dvrBuffer(NULL, 0)
+	enabled(false), frontendFd(-1), singleDemux(false), fullTsPidCount(0), sharedDmxFd(-1),
+	sharedDmxFullTs(false), dvrFd(-1),
+	dvrKernelBufferSize(defaultDvrKernelBufferSize), dvrBuffer(NULL, 0), dvrPendingSize(0),
+	dvrSynced(false), syncLosses(0), teiPackets(0), skippedBytes(0), loggedSyncLosses(0),
+	loggedTeiPackets(0), loggedSkippedBytes(0), readerThread(NULL)
 {
 	dvrPipe[0] = -1;
 	dvrPipe[1] = -1;
@@ -48,6 +60,19 @@ DvbLinuxDevice::~DvbLinuxDevice()
 	stopDevice();
 }
 
+void DvbLinuxDevice::setReaderThread(DvbLinuxReaderThread *readerThread_)
+{
+	Q_ASSERT(dvrFd < 0);
+	readerThread = readerThread_;
+}
+
+void DvbLinuxDevice::setDemuxOptions(bool singleDemux_, int fullTsPidCount_)
+{
+	Q_ASSERT(sharedDmxFd < 0);
+	singleDemux = singleDemux_;
+	fullTsPidCount = qMax(fullTsPidCount_, 0);
+}
+
 bool DvbLinuxDevice::isReady() const
 {
 	return ready;
@@ -569,15 +594,61 @@ int DvbLinuxDevice::getSnr()
 	return ((snr * 100 + 0x8001) >> 16);
 }
 
+int DvbLinuxDevice::getSyncLossCount()
+{
+	return syncLosses.load();
+}
+
+int DvbLinuxDevice::getTransportErrorCount()
+{
+	return teiPackets.load();
+}
+
+qint64 DvbLinuxDevice::getSkippedBytes()
+{
+	return skippedBytes.load();
+}
+
 bool DvbLinuxDevice::addPidFilter(int pid)
 {
 	Q_ASSERT(frontendFd >= 0);
 
-	if (dmxFds.contains(pid)) {
+	if (dmxFds.contains(pid) || sharedDmxPids.contains(pid)) {
 		Log("DvbLinuxDevice::addPidFilter: pid filter already set up for pid") << pid;
 		return false;
 	}
 
+	if (singleDemux) {
+		sharedDmxPids.append(pid);
+		bool fullTs = ((fullTsPidCount > 0) && (sharedDmxPids.size() > fullTsPidCount));
+
+		if ((sharedDmxFd >= 0) && (fullTs == sharedDmxFullTs)) {
+			if (fullTs) {
+				return true;
+			}
+
+			__u16 dmxPid = __u16(pid);
+
+			if (ioctl(sharedDmxFd, DMX_ADD_PID, &dmxPid) == 0) {
+				return true;
+			}
+
+			sharedDmxPids.removeLast();
+		} else {
+			if (openSharedDemux()) {
+				return true;
+			}
+
+			sharedDmxPids.removeLast();
+			openSharedDemux();
+		}
+
+		// probably not supported by the driver
+		Log("DvbLinuxDevice::addPidFilter: cannot add pid to shared demux, "
+		    "using one demux per pid") << demuxPath;
+		singleDemux = false;
+	}
+
 	int dmxFd = open(QFile::encodeName(demuxPath).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
 
 	if (dmxFd < 0) {
@@ -608,6 +679,23 @@ void DvbLinuxDevice::removePidFilter(int pid)
 {
 	Q_ASSERT(frontendFd >= 0);
 
+	if (sharedDmxPids.removeOne(pid)) {
+		bool fullTs = ((fullTsPidCount > 0) && (sharedDmxPids.size() > fullTsPidCount));
+
+		if (sharedDmxPids.isEmpty() || (fullTs != sharedDmxFullTs)) {
+			openSharedDemux();
+		} else if (!fullTs) {
+			__u16 dmxPid = __u16(pid);
+
+			if (ioctl(sharedDmxFd, DMX_REMOVE_PID, &dmxPid) != 0) {
+				Log("DvbLinuxDevice::removePidFilter: cannot remove pid from demux") <<
+					demuxPath;
+			}
+		}
+
+		return;
+	}
+
 	if (!dmxFds.contains(pid)) {
 		Log("DvbLinuxDevice::removePidFilter: no pid filter set up for pid") << pid;
 		return;
@@ -616,6 +704,64 @@ void DvbLinuxDevice::removePidFilter(int pid)
 	close(dmxFds.take(pid));
 }
 
+// (re)opens the shared demux for the pids in sharedDmxPids
+
+bool DvbLinuxDevice::openSharedDemux()
+{
+	if (sharedDmxFd >= 0) {
+		close(sharedDmxFd);
+		sharedDmxFd = -1;
+	}
+
+	if (sharedDmxPids.isEmpty()) {
+		return true;
+	}
+
+	int dmxFd = open(QFile::encodeName(demuxPath).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+	if (dmxFd < 0) {
+		Log("DvbLinuxDevice::openSharedDemux: cannot open demux") << demuxPath;
+		return false;
+	}
+
+	bool fullTs = ((fullTsPidCount > 0) && (sharedDmxPids.size() > fullTsPidCount));
+
+	dmx_pes_filter_params pes_filter;
+	memset(&pes_filter, 0, sizeof(pes_filter));
+	pes_filter.pid = ushort(fullTs ? 0x2000 : sharedDmxPids.at(0));
+	pes_filter.input = DMX_IN_FRONTEND;
+	pes_filter.output = DMX_OUT_TS_TAP;
+	pes_filter.pes_type = DMX_PES_OTHER;
+	pes_filter.flags = 0;
+
+	if (ioctl(dmxFd, DMX_SET_PES_FILTER, &pes_filter) != 0) {
+		Log("DvbLinuxDevice::openSharedDemux: cannot set up pid filter for demux") <<
+			demuxPath;
+		close(dmxFd);
+		return false;
+	}
+
+	for (int i = 1; !fullTs && (i < sharedDmxPids.size()); ++i) {
+		__u16 dmxPid = __u16(sharedDmxPids.at(i));
+
+		if (ioctl(dmxFd, DMX_ADD_PID, &dmxPid) != 0) {
+			Log("DvbLinuxDevice::openSharedDemux: cannot add pid to demux") << demuxPath;
+			close(dmxFd);
+			return false;
+		}
+	}
+
+	if (ioctl(dmxFd, DMX_START) != 0) {
+		Log("DvbLinuxDevice::openSharedDemux: cannot start demux") << demuxPath;
+		close(dmxFd);
+		return false;
+	}
+
+	sharedDmxFd = dmxFd;
+	sharedDmxFullTs = fullTs;
+	return true;
+}
+
 void DvbLinuxDevice::startDescrambling(const QByteArray &pmtSectionData)
 {
 	cam.startDescrambling(pmtSectionData);
@@ -651,12 +797,21 @@ void DvbLinuxDevice::release()
 		dvrFd = -1;
 	}
 
+	dvrKernelBufferSize = defaultDvrKernelBufferSize;
+
 	foreach (int dmxFd, dmxFds) {
 		close(dmxFd);
 	}
 
 	dmxFds.clear();
 
+	if (sharedDmxFd >= 0) {
+		close(sharedDmxFd);
+		sharedDmxFd = -1;
+	}
+
+	sharedDmxPids.clear();
+
 	if (frontendFd >= 0) {
 		close(frontendFd);
 		frontendFd = -1;
@@ -683,6 +838,17 @@ void DvbLinuxDevice::startDvr()
 		dvrBuffer = frontend->getBuffer();
 	}
 
+	// the kernel should be able to hold a few data buffers while we are busy
+
+	if ((4 * dvrBuffer.bufferSize) > dvrKernelBufferSize) {
+		if (ioctl(dvrFd, DMX_SET_BUFFER_SIZE, 4 * dvrBuffer.bufferSize) == 0) {
+			dvrKernelBufferSize = (4 * dvrBuffer.bufferSize);
+		} else {
+			Log("DvbLinuxDevice::startDvr: ioctl DMX_SET_BUFFER_SIZE failed for dvr") <<
+				dvrPath;
+		}
+	}
+
 	while (true) {
 		int bufferSize = dvrBuffer.bufferSize;
 		int dataSize = int(read(dvrFd, dvrBuffer.data, bufferSize));
@@ -717,12 +883,23 @@ void DvbLinuxDevice::startDvr()
 		}
 	}
 
+	// the stale data has been thrown away
+	dvrPendingSize = 0;
+	dvrSynced = false;
+
+	if (readerThread != NULL) {
+		readerThread->addDevice(this);
+		return;
+	}
+
 	start();
 }
 
 void DvbLinuxDevice::stopDvr()
 {
-	if (isRunning()) {
+	if (readerThread != NULL) {
+		readerThread->removeDevice(this);
+	} else if (isRunning()) {
 		Q_ASSERT((dvrPipe[0] >= 0) && (dvrPipe[1] >= 0));
 
 		if (write(dvrPipe[1], " ", 1) != 1) {
@@ -736,6 +913,20 @@ void DvbLinuxDevice::stopDvr()
 			Log("DvbLinuxDevice::stopDvr: cannot read from pipe");
 		}
 	}
+
+	// the reader thread doesn't change the counters anymore
+	int newSyncLosses = (syncLosses.load() - loggedSyncLosses);
+	int newTeiPackets = (teiPackets.load() - loggedTeiPackets);
+	qint64 newSkippedBytes = (skippedBytes.load() - loggedSkippedBytes);
+
+	if ((newSyncLosses != 0) || (newTeiPackets != 0) || (newSkippedBytes != 0)) {
+		Log("DvbLinuxDevice::stopDvr: sync losses") << newSyncLosses << "tei packets" <<
+			newTeiPackets << "skipped bytes" << newSkippedBytes << dvrPath;
+	}
+
+	loggedSyncLosses = syncLosses.load();
+	loggedTeiPackets = teiPackets.load();
+	loggedSkippedBytes = skippedBytes.load();
 }
 
 void DvbLinuxDevice::run()
@@ -762,9 +953,31 @@ void DvbLinuxDevice::run()
 			return;
 		}
 
-		while (true) {
-			int bufferSize = dvrBuffer.bufferSize;
-			int dataSize = int(read(dvrFd, dvrBuffer.data, bufferSize));
+		if (!readDvr()) {
+			return;
+		}
+
+		msleep(10);
+	}
+}
+
+bool DvbLinuxDevice::readDvr()
+{
+	while (true) {
+		int bufferSize = (dvrBuffer.bufferSize - dvrPendingSize);
+		int dataSize = int(read(dvrFd, dvrBuffer.data + dvrPendingSize, bufferSize));
+
+		if (dataSize < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				break;
+			}
+
+			if (errno == EINTR) {
+				continue;
+			}
+
+			Log("DvbLinuxDevice::readDvr: cannot read from dvr") << dvrPath;
+			dataSize = int(read(dvrFd, dvrBuffer.data + dvrPendingSize, bufferSize));
 
 			if (dataSize < 0) {
 				if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
@@ -775,40 +988,235 @@ void DvbLinuxDevice::run()
 					continue;
 				}
 
-				Log("DvbLinuxDevice::run: cannot read from dvr") << dvrPath;
-				dataSize = int(read(dvrFd, dvrBuffer.data, bufferSize));
+				Log("DvbLinuxDevice::readDvr: cannot read from dvr") << dvrPath;
+				return false;
+			}
+		}
+
+		if (dataSize > 0) {
+			int alignedSize = alignDvrData(dvrPendingSize + dataSize);
 
-				if (dataSize < 0) {
-					if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-						break;
-					}
+			if (alignedSize > 0) {
+				DvbDataBuffer nextBuffer = frontend->getBuffer();
+				memcpy(nextBuffer.data, dvrBuffer.data + alignedSize, dvrPendingSize);
+				dvrBuffer.dataSize = alignedSize;
+				frontend->writeBuffer(dvrBuffer);
+				dvrBuffer = nextBuffer;
+			}
+		}
 
-					if (errno == EINTR) {
-						continue;
-					}
+		if (dataSize != bufferSize) {
+			break;
+		}
+	}
 
-					Log("DvbLinuxDevice::run: cannot read from dvr") <<
-						dvrPath;
-					return;
+	return true;
+}
+
+// moves the valid packets to the start of dvrBuffer and returns their size; the remaining
+// (incomplete or unconfirmed) data is kept directly after them (see dvrPendingSize)
+
+int DvbLinuxDevice::alignDvrData(int size)
+{
+	char *data = dvrBuffer.data;
+	int readPos = 0;
+	int writePos = 0;
+
+	while ((size - readPos) >= 188) {
+		if (dvrSynced) {
+			if (data[readPos] == 0x47) {
+				if ((data[readPos + 1] & 0x80) != 0) {
+					// transport error indicator
+					teiPackets.ref();
 				}
+
+				if (writePos != readPos) {
+					memmove(data + writePos, data + readPos, 188);
+				}
+
+				readPos += 188;
+				writePos += 188;
+				continue;
 			}
 
-			if (dataSize > 0) {
-				dvrBuffer.dataSize = dataSize;
-				frontend->writeBuffer(dvrBuffer);
-				dvrBuffer = frontend->getBuffer();
+			// only counted here; stopDvr() logs a summary
+			dvrSynced = false;
+			syncLosses.ref();
+		}
+
+		// look for two sync bytes which are one packet apart
+		int searchPos = readPos;
+
+		while (true) {
+			const char *syncByte = static_cast<const char *>(
+				memchr(data + searchPos, 0x47, size - 188 - searchPos));
+
+			if (syncByte == NULL) {
+				searchPos = (size - 188);
+				break;
 			}
 
-			if (dataSize != bufferSize) {
+			searchPos = int(syncByte - data);
+
+			if (data[searchPos + 188] == 0x47) {
+				dvrSynced = true;
 				break;
 			}
+
+			++searchPos;
 		}
 
-		msleep(10);
+		if (searchPos != readPos) {
+			skippedBytes.fetchAndAddRelaxed(searchPos - readPos);
+		}
+
+		readPos = searchPos;
+
+		if (!dvrSynced) {
+			break;
+		}
+	}
+
+	dvrPendingSize = (size - readPos);
+
+	if ((dvrPendingSize > 0) && (writePos != readPos)) {
+		memmove(data + writePos, data + readPos, dvrPendingSize);
+	}
+
+	return writePos;
+}
+
+DvbLinuxReaderThread::DvbLinuxReaderThread(int cpu_) : cpu(cpu_)
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (epollFd < 0) {
+		Log("DvbLinuxReaderThread::DvbLinuxReaderThread: cannot create epoll instance");
+	}
+
+	stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (stopFd < 0) {
+		Log("DvbLinuxReaderThread::DvbLinuxReaderThread: cannot create eventfd");
+	}
+
+	if ((epollFd >= 0) && (stopFd >= 0)) {
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event) == 0) {
+			start();
+		} else {
+			Log("DvbLinuxReaderThread::DvbLinuxReaderThread: epoll_ctl failed");
+		}
+	}
+}
+
+DvbLinuxReaderThread::~DvbLinuxReaderThread()
+{
+	if (isRunning()) {
+		quint64 value = 1;
+
+		if (write(stopFd, &value, sizeof(value)) != sizeof(value)) {
+			Log("DvbLinuxReaderThread::~DvbLinuxReaderThread: cannot write to eventfd");
+		}
+
+		wait();
+	}
+
+	if (stopFd >= 0) {
+		close(stopFd);
+	}
+
+	if (epollFd >= 0) {
+		close(epollFd);
+	}
+}
+
+void DvbLinuxReaderThread::addDevice(DvbLinuxDevice *device)
+{
+	QMutexLocker locker(&mutex);
+
+	if (devices.contains(device)) {
+		return;
+	}
+
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = device;
+
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, device->dvrFd, &event) != 0) {
+		Log("DvbLinuxReaderThread::addDevice: epoll_ctl failed for dvr") << device->dvrPath;
+		return;
+	}
+
+	devices.insert(device);
+}
+
+void DvbLinuxReaderThread::removeDevice(DvbLinuxDevice *device)
+{
+	// waits until the current round of reads is finished
+	QMutexLocker locker(&mutex);
+
+	if (devices.remove(device)) {
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, device->dvrFd, NULL);
+	}
+}
+
+void DvbLinuxReaderThread::run()
+{
+	if (cpu >= 0) {
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(cpu, &cpuSet);
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+			Log("DvbLinuxReaderThread::run: cannot set cpu affinity") << cpu;
+		}
+	}
+
+	epoll_event events[16];
+
+	while (true) {
+		int count = epoll_wait(epollFd, events, 16, -1);
+
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			Log("DvbLinuxReaderThread::run: epoll_wait failed");
+			return;
+		}
+
+		QMutexLocker locker(&mutex);
+
+		for (int i = 0; i < count; ++i) {
+			DvbLinuxDevice *device = static_cast<DvbLinuxDevice *>(events[i].data.ptr);
+
+			if (device == NULL) {
+				// stop requested
+				return;
+			}
+
+			// the device may have been removed in the meantime
+			if (!devices.contains(device)) {
+				continue;
+			}
+
+			if (!device->readDvr()) {
+				devices.remove(device);
+				epoll_ctl(epollFd, EPOLL_CTL_DEL, device->dvrFd, NULL);
+			}
+		}
 	}
 }
 
-DvbLinuxDeviceManager::DvbLinuxDeviceManager(QObject *parent) : QObject(parent)
+DvbLinuxDeviceManager::DvbLinuxDeviceManager(QObject *parent) : QObject(parent),
+	singleDemux(false), fullTsPidCount(0)
 {
     udev = udev_new();
 
@@ -824,11 +1232,34 @@ DvbLinuxDeviceManager::DvbLinuxDeviceManager(QObject *parent) : QObject(parent)
 
 DvbLinuxDeviceManager::~DvbLinuxDeviceManager()
 {
+	// the devices have to be stopped before the reader threads
+	qDeleteAll(devices);
+	devices.clear();
+	udis.clear();
+	qDeleteAll(readerThreads);
+
     delete monitorNotifier;
     udev_monitor_unref(monitor);
     udev_unref(udev);
 }
 
+void DvbLinuxDeviceManager::setReaderThreads(int threadCount, const QList<int> &cpus)
+{
+	Q_ASSERT(readerThreads.isEmpty() && devices.isEmpty());
+
+	for (int i = 0; i < threadCount; ++i) {
+		readerThreads.append(new DvbLinuxReaderThread(cpus.isEmpty() ? -1 :
+			cpus.at(i % cpus.size())));
+	}
+}
+
+void DvbLinuxDeviceManager::setDemuxOptions(bool singleDemux_, int fullTsPidCount_)
+{
+	Q_ASSERT(devices.isEmpty());
+	singleDemux = singleDemux_;
+	fullTsPidCount = fullTsPidCount_;
+}
+
 void DvbLinuxDeviceManager::doColdPlug()
 {
     udev_enumerate* en = udev_enumerate_new(udev);
@@ -873,7 +1304,14 @@ void DvbLinuxDeviceManager::componentAdded(const QString &udi)
 
 	if (device == NULL) {
 		device = new DvbLinuxDevice(this);
+		device->setDemuxOptions(singleDemux, fullTsPidCount);
 		devices.insert(deviceIndex, device);
+
+		if (!readerThreads.isEmpty()) {
+			// distribute the adapters evenly
+			device->setReaderThread(readerThreads.at((devices.size() - 1) %
+				readerThreads.size()));
+		}
 	}
 
 	bool addDevice = false;
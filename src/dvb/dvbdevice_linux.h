@@ -21,16 +21,27 @@
 #ifndef DVBDEVICE_LINUX_H
 #define DVBDEVICE_LINUX_H
 
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QSet>
 #include <QThread>
 #include "dvbbackenddevice.h"
 #include "dvbcam_linux.h"
 
+class DvbLinuxReaderThread;
+
 class DvbLinuxDevice : public QThread, public DvbBackendDevice
 {
+	friend class DvbLinuxReaderThread;
 public:
 	explicit DvbLinuxDevice(QObject *parent);
 	~DvbLinuxDevice();
 
+	// the shared reader thread is used instead of a separate thread if set (NULL = none)
+	void setReaderThread(DvbLinuxReaderThread *readerThread_);
+	// singleDemux = use one demux fd for all pids; fullTsPidCount = pass the whole transport
+	// stream if more pids are needed (0 = never)
+	void setDemuxOptions(bool singleDemux_, int fullTsPidCount_);
 	bool isReady() const;
 	void startDevice(const QString &deviceId_);
 	void startCa();
@@ -62,6 +73,9 @@ protected:
 	bool isTuned();
 	int getSignal(); // 0 - 100 [%] or -1 = not supported
 	int getSnr(); // 0 - 100 [%] or -1 = not supported
+	int getSyncLossCount();
+	int getTransportErrorCount();
+	qint64 getSkippedBytes();
 	bool addPidFilter(int pid);
 	void removePidFilter(int pid);
 	void startDescrambling(const QByteArray &pmtSectionData);
@@ -72,6 +86,9 @@ private:
 	void startDvr();
 	void stopDvr();
 	void run();
+	bool readDvr(); // returns false if the dvr can't be read anymore
+	bool openSharedDemux();
+	int alignDvrData(int size);
 
 	bool ready;
 	QString deviceId;
@@ -82,14 +99,52 @@ private:
 	bool enabled;
 	int frontendFd;
 	QMap<int, int> dmxFds;
+	bool singleDemux;
+	int fullTsPidCount;
+	int sharedDmxFd;
+	bool sharedDmxFullTs;
+	QList<int> sharedDmxPids;
 
 	int dvrFd;
+	int dvrKernelBufferSize;
 	int dvrPipe[2];
 	DvbDataBuffer dvrBuffer;
-
+	int dvrPendingSize; // incomplete packet at the start of dvrBuffer
+	bool dvrSynced;
+
+	// corruption counters (incremented by the dvr thread, never reset)
+	QAtomicInt syncLosses;
+	QAtomicInt teiPackets;
+	QAtomicInteger<qint64> skippedBytes;
+	int loggedSyncLosses; // values of the last summary in stopDvr()
+	int loggedTeiPackets;
+	qint64 loggedSkippedBytes;
+
+	DvbLinuxReaderThread *readerThread;
 	DvbLinuxCam cam;
 };
 
+// multiplexes the dvr devices of several adapters using epoll
+
+class DvbLinuxReaderThread : public QThread
+{
+public:
+	explicit DvbLinuxReaderThread(int cpu_); // cpu < 0 = no affinity
+	~DvbLinuxReaderThread();
+
+	void addDevice(DvbLinuxDevice *device);
+	void removeDevice(DvbLinuxDevice *device); // the device isn't in use after returning
+
+private:
+	void run();
+
+	int cpu;
+	int epollFd;
+	int stopFd;
+	QMutex mutex; // held while reading from the devices
+	QSet<DvbLinuxDevice *> devices;
+};
+
 class DvbLinuxDeviceManager : public QObject
 {
 	Q_OBJECT
@@ -97,6 +152,11 @@ public:
 	explicit DvbLinuxDeviceManager(QObject *parent);
 	~DvbLinuxDeviceManager();
 
+	// threadCount = 0 means one reader thread per device; the threads are bound to the
+	// given cpus in turn (empty = no affinity); has to be called before doColdPlug()
+	void setReaderThreads(int threadCount, const QList<int> &cpus);
+	void setDemuxOptions(bool singleDemux_, int fullTsPidCount_); // see DvbLinuxDevice
+
 public slots:
 	void doColdPlug();
 
@@ -115,6 +175,9 @@ private:
 
 	QMap<int, DvbLinuxDevice *> devices;
 	QMap<QString, DvbLinuxDevice *> udis;
+	QList<DvbLinuxReaderThread *> readerThreads;
+	bool singleDemux;
+	int fullTsPidCount;
     struct udev* udev;
     struct udev_monitor* monitor;
     QSocketNotifier* monitorNotifier;
@@ -21,15 +21,130 @@
 #ifndef DVBDEVICE_P_H
 #define DVBDEVICE_P_H
 
+#include <QAtomicInt>
+#include <QVector>
+
+class DvbDeviceDataPool;
+
 class DvbDeviceDataBuffer
 {
 public:
-	DvbDeviceDataBuffer() { }
+	DvbDeviceDataBuffer(DvbDeviceDataPool *pool_, char *slab, int bufferSize_) :
+		data(slab + sizeof(DvbDeviceDataBuffer *)), size(0), bufferSize(bufferSize_),
+		pool(pool_)
+	{
+		// the slab starts with a back pointer, so that writeBuffer() can find the buffer
+		*reinterpret_cast<DvbDeviceDataBuffer **>(slab) = this;
+	}
+
 	~DvbDeviceDataBuffer() { }
 
-	char data[5 * 188];
+	static DvbDeviceDataBuffer *fromData(char *data)
+	{
+		return *reinterpret_cast<DvbDeviceDataBuffer **>(data - sizeof(DvbDeviceDataBuffer *));
+	}
+
+	char *data;
 	int size;
-	DvbDeviceDataBuffer *next;
+	int bufferSize; // multiple of 188
+	DvbDeviceDataPool *pool;
+
+private:
+	Q_DISABLE_COPY(DvbDeviceDataBuffer)
+};
+
+// a fixed number of preallocated data buffers plus two spare buffers, which are handed out
+// when the pool is exhausted (their data is dropped); the pool is deleted after the device
+// and all taken buffers have released it
+
+class DvbDeviceDataPool
+{
+public:
+	DvbDeviceDataPool(int bufferSize_, int bufferCount_, bool lockMemory);
+
+	static void release(DvbDeviceDataPool *pool);
+
+	// the following functions may only be called by the backend thread
+
+	DvbDeviceDataBuffer *takeBuffer(); // returns NULL if all buffers are in use
+	DvbDeviceDataBuffer *takeSpareBuffer(); // alternates, as the backend may hold two buffers
+	static void returnBuffer(DvbDeviceDataBuffer *buffer);
+
+	bool isSpareBuffer(const DvbDeviceDataBuffer *buffer) const
+	{
+		return ((buffer == buffers.at(bufferCount)) || (buffer == buffers.at(bufferCount + 1)));
+	}
+
+	int bufferSize;
+	int bufferCount;
+
+private:
+	~DvbDeviceDataPool();
+	Q_DISABLE_COPY(DvbDeviceDataPool)
+
+	QAtomicInt refCount;
+	char *memory;
+	size_t memorySize;
+	bool mapped;
+	QVector<DvbDeviceDataBuffer *> buffers;
+	QVector<DvbDeviceDataBuffer *> returnedBuffers;
+	int nextBuffer;
+	int nextSpareBuffer;
+};
+
+// lock-free queue for exactly one producer thread and one consumer thread
+
+class DvbDeviceDataRing
+{
+public:
+	enum {
+		Capacity = 512 // must be a power of two
+	};
+
+	DvbDeviceDataRing() : readIndex(0), writeIndex(0) { }
+	~DvbDeviceDataRing() { }
+
+	// producer side; returns false if the ring is full
+	bool push(DvbDeviceDataBuffer *buffer)
+	{
+		int index = writeIndex.load();
+		int nextIndex = ((index + 1) & (Capacity - 1));
+
+		if (nextIndex == readIndex.loadAcquire()) {
+			return false;
+		}
+
+		buffers[index] = buffer;
+		writeIndex.storeRelease(nextIndex);
+		return true;
+	}
+
+	// consumer side; returns NULL if the ring is empty
+	DvbDeviceDataBuffer *pop()
+	{
+		int index = readIndex.load();
+
+		if (index == writeIndex.loadAcquire()) {
+			return NULL;
+		}
+
+		DvbDeviceDataBuffer *buffer = buffers[index];
+		readIndex.storeRelease((index + 1) & (Capacity - 1));
+		return buffer;
+	}
+
+	// consumer side
+	bool isEmpty() const
+	{
+		return (readIndex.load() == writeIndex.loadAcquire());
+	}
+
+private:
+	Q_DISABLE_COPY(DvbDeviceDataRing)
+
+	QAtomicInt readIndex;
+	QAtomicInt writeIndex;
+	DvbDeviceDataBuffer *buffers[Capacity];
 };
 
 #endif /* DVBDEVICE_P_H */
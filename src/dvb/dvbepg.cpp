@@ -505,6 +505,8 @@ void DvbEpgFilter::processSection(const char *data, int size)
 		return;
 	}
 
+	QDateTime currentDateTimeUtc = QDateTime::currentDateTimeUtc();
+
 	for (DvbEitSectionEntry entry = eitSection.entries(); entry.isValid(); entry.advance()) {
 		DvbEpgEntry epgEntry;
 		epgEntry.channel = channel;
@@ -512,6 +514,11 @@ void DvbEpgFilter::processSection(const char *data, int size)
 			bcdToTime(entry.startTime()), Qt::UTC);
 		epgEntry.duration = bcdToTime(entry.duration());
 
+		if (epgEntry.begin.addSecs(QTime().secsTo(epgEntry.duration)) <= currentDateTimeUtc) {
+			// the model drops past entries anyway; don't decode their texts
+			continue;
+		}
+
 		for (DvbDescriptor descriptor = entry.descriptors(); descriptor.isValid();
 		     descriptor.advance()) {
 			switch (descriptor.descriptorTag()) {
@@ -40,6 +40,11 @@ private:
 
 	void processSection(const char *data, int size);
 
+	bool isChangesOnly() const
+	{
+		return true;
+	}
+
 	DvbChannelModel *channelModel;
 	DvbEpgModel *epgModel;
 };
@@ -54,6 +59,11 @@ private:
 	Q_DISABLE_COPY(AtscEpgMgtFilter)
 	void processSection(const char *data, int size);
 
+	bool isChangesOnly() const
+	{
+		return true;
+	}
+
 	AtscEpgFilter *epgFilter;
 };
 
@@ -67,6 +77,11 @@ private:
 	Q_DISABLE_COPY(AtscEpgEitFilter)
 	void processSection(const char *data, int size);
 
+	bool isChangesOnly() const
+	{
+		return true;
+	}
+
 	AtscEpgFilter *epgFilter;
 };
 
@@ -78,6 +93,7 @@ public:
 
 private:
 	Q_DISABLE_COPY(AtscEpgEttFilter)
+	// repetitions are needed, because texts are dropped until the event is known
 	void processSection(const char *data, int size);
 
 	AtscEpgFilter *epgFilter;
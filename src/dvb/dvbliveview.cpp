@@ -22,6 +22,7 @@
 #include "dvbliveview_p.h"
 
 #include <QDir>
+#include <QFile>
 #include <QPainter>
 #include <QSet>
 #include <QSocketNotifier>
@@ -135,7 +136,8 @@ QPixmap DvbOsd::paintOsd(QRect &rect, const QFont &font, Qt::LayoutDirection)
 }
 
 DvbLiveView::DvbLiveView(DvbManager *manager_, QObject *parent) : QObject(parent),
-	manager(manager_), device(NULL), videoPid(-1), audioPid(-1), subtitlePid(-1)
+	manager(manager_), device(NULL), switchingChannel(false), pausedTimeShift(false),
+	videoPid(-1), audioPid(-1), subtitlePid(-1)
 {
 	mediaWidget = manager->getMediaWidget();
 	osdWidget = mediaWidget->getOsdWidget();
@@ -153,6 +155,7 @@ DvbLiveView::DvbLiveView(DvbManager *manager_, QObject *parent) : QObject(parent
 	connect(internal, SIGNAL(currentSubtitleChanged(int)),
 		this, SLOT(currentSubtitleChanged(int)));
 	connect(internal, SIGNAL(replay()), this, SLOT(replay()));
+	connect(internal, SIGNAL(skip(int)), this, SLOT(skip(int)));
 	connect(internal, SIGNAL(playbackFinished()), this, SLOT(playbackFinished()));
 	connect(internal, SIGNAL(playbackStatusChanged(MediaWidget::PlaybackStatus)),
 		this, SLOT(playbackStatusChanged(MediaWidget::PlaybackStatus)));
@@ -194,7 +197,9 @@ void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 			DvbManager::Shared);
 	}
 
+	switchingChannel = true;
 	playbackStatusChanged(MediaWidget::Idle);
+	switchingChannel = false;
 	channel = channel_;
 	device = newDevice;
 
@@ -220,20 +225,30 @@ void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 
 	internal->channelName = channel->name;
 	internal->resetPipe();
+
+	if (manager->isTimeShiftAlwaysEnabled() && !startTimeShift()) {
+		// live playback works without it, only rewinding isn't possible
+		osdWidget->showText(i18nc("osd", "Time Shift Not Available"), 2500);
+	}
+
 	mediaWidget->play(internal);
 
 	internal->pmtFilter.setProgramNumber(channel->serviceId);
 	startDevice();
 
+	internal->mutex.lock();
 	internal->patGenerator.initPat(channel->transportStreamId, channel->serviceId,
 		channel->pmtPid);
+	internal->mutex.unlock();
 	videoPid = -1;
 	audioPid = channel->audioPid;
 	subtitlePid = -1;
 	pmtSectionChanged(channel->pmtSectionData);
 	patPmtTimer.start(500);
 
+	internal->mutex.lock();
 	internal->buffer.reserve(87 * 188);
+	internal->mutex.unlock();
 	QTimer::singleShot(2000, this, SLOT(showOsd()));
 }
 
@@ -304,7 +319,7 @@ void DvbLiveView::pmtSectionChanged(const QByteArray &pmtSectionData)
 		device->startDescrambling(internal->pmtSectionData, this);
 	}
 
-	if (internal->timeShiftFile.isOpen()) {
+	if (pausedTimeShift) {
 		return;
 	}
 
@@ -347,6 +362,7 @@ void DvbLiveView::pmtSectionChanged(const QByteArray &pmtSectionData)
 
 void DvbLiveView::insertPatPmt()
 {
+	QMutexLocker locker(&internal->mutex);
 	internal->buffer.append(internal->patGenerator.generatePackets());
 	internal->buffer.append(internal->pmtGenerator.generatePackets());
 }
@@ -414,46 +430,41 @@ void DvbLiveView::playbackStatusChanged(MediaWidget::PlaybackStatus playbackStat
 		osdTimer.stop();
 
 		internal->pmtSectionData.clear();
+		// processPackets() may still be running in the device thread
+		internal->mutex.lock();
 		internal->patGenerator = DvbSectionGenerator();
 		internal->pmtGenerator = DvbSectionGenerator();
 		internal->buffer.clear();
-		internal->timeShiftFile.close();
+		internal->mutex.unlock();
+
+		if (switchingChannel && manager->isTimeShiftAlwaysEnabled()) {
+			// avoid reserving a new file for every channel
+			internal->timeShiftBuffer.clear();
+		} else {
+			internal->timeShiftBuffer.close();
+		}
+
+		pausedTimeShift = false;
+		internal->mutex.lock();
+		internal->timeShiftPosition = 0;
+		internal->mutex.unlock();
 		internal->dvbOsd.init(DvbOsd::Off, QString(), QList<DvbSharedEpgEntry>());
 		osdWidget->hideObject();
 		break;
 	case MediaWidget::Playing:
-		if (internal->timeShiftFile.isOpen()) {
-			// FIXME
-			mediaWidget->play(internal);
-		}
-
+		// when resuming, the backend continues reading from the time shift buffer
 		break;
 	case MediaWidget::Paused:
-		if (internal->timeShiftFile.isOpen()) {
+		if (internal->timeShiftBuffer.isOpen()) {
 			break;
 		}
 
-		internal->timeShiftFile.setFileName(manager->getTimeShiftFolder() + QLatin1String("/TimeShift-") +
-			QDateTime::currentDateTime().toString(QLatin1String("yyyyMMddThhmmss")) +
-			QLatin1String(".m2t"));
-
-		if (internal->timeShiftFile.exists() ||
-		    !internal->timeShiftFile.open(QIODevice::WriteOnly)) {
-			Log("DvbLiveView::playbackStatusChanged: cannot open file") <<
-				internal->timeShiftFile.fileName();
-			internal->timeShiftFile.setFileName(QDir::homePath() + QLatin1String("/TimeShift-") +
-				QDateTime::currentDateTime().toString(QLatin1String("yyyyMMddThhmmss")) +
-				QLatin1String(".m2t"));
-
-			if (internal->timeShiftFile.exists() ||
-			    !internal->timeShiftFile.open(QIODevice::WriteOnly)) {
-				Log("DvbLiveView::playbackStatusChanged: cannot open file") <<
-					internal->timeShiftFile.fileName();
-				mediaWidget->stop();
-				break;
-			}
+		if (!startTimeShift()) {
+			mediaWidget->stop();
+			break;
 		}
 
+		pausedTimeShift = true;
 		updatePids();
 
 		// don't allow changes after starting time shift
@@ -467,6 +478,20 @@ void DvbLiveView::playbackStatusChanged(MediaWidget::PlaybackStatus playbackStat
 	}
 }
 
+void DvbLiveView::skip(int milliseconds)
+{
+	qint64 elapsedTime = timeShiftTimer.elapsed();
+
+	if (!internal->timeShiftBuffer.isOpen() || (elapsedTime <= 0)) {
+		return;
+	}
+
+	// based on the average bitrate since the start of the time shift
+	internal->seekTimeShift((milliseconds * internal->timeShiftBuffer.getEndPosition()) /
+		elapsedTime);
+	mediaWidget->play(internal);
+}
+
 void DvbLiveView::showOsd()
 {
 	if (internal->dvbOsd.level == DvbOsd::Off) {
@@ -512,19 +537,45 @@ void DvbLiveView::stopDevice()
 	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
 }
 
+bool DvbLiveView::startTimeShift()
+{
+	if (internal->timeShiftBuffer.isOpen()) {
+		// kept by playChannel()
+		timeShiftTimer.start();
+		mediaWidget->seekableChanged();
+		return true;
+	}
+
+	QString fileName = QLatin1String("/TimeShift-") +
+		QDateTime::currentDateTime().toString(QLatin1String("yyyyMMddThhmmss")) +
+		QLatin1String(".m2t");
+	qint64 size = (qint64(manager->getTimeShiftSize()) << 20);
+
+	if (!internal->timeShiftBuffer.open(manager->getTimeShiftFolder() + fileName, size) &&
+	    !internal->timeShiftBuffer.open(QDir::homePath() + fileName, size)) {
+		Log("DvbLiveView::startTimeShift: cannot open time shift buffer");
+		return false;
+	}
+
+	timeShiftTimer.start();
+	mediaWidget->seekableChanged();
+	return true;
+}
+
 void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 {
 	DvbPmtSection pmtSection(internal->pmtSectionData);
 	DvbPmtParser pmtParser(pmtSection);
 	QSet<int> newPids;
 	bool updatePatPmt = forcePatPmtUpdate;
-	bool isTimeShifting = internal->timeShiftFile.isOpen();
+	// with an always enabled time shift only the selected streams are recorded
+	bool recordAllStreams = pausedTimeShift;
 
 	if (videoPid != -1) {
 		newPids.insert(videoPid);
 	}
 
-	if (!isTimeShifting) {
+	if (!recordAllStreams) {
 		if (audioPid != -1) {
 			newPids.insert(audioPid);
 		}
@@ -534,7 +585,7 @@ void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 		}
 	}
 
-	if (!isTimeShifting) {
+	if (!recordAllStreams) {
 		if (subtitlePid != -1) {
 			newPids.insert(subtitlePid);
 		}
@@ -565,60 +616,96 @@ void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 		updatePatPmt = true;
 	}
 
+	// processPackets() uses the generators and the video pid as well
+	internal->mutex.lock();
+	internal->videoPid = videoPid;
+
 	if (updatePatPmt) {
 		internal->pmtGenerator.initPmt(channel->pmtPid, pmtSection, pids);
+	}
+
+	internal->mutex.unlock();
+
+	if (updatePatPmt) {
 		insertPatPmt();
 	}
 }
 
 DvbLiveViewInternal::DvbLiveViewInternal(QObject *parent) : QObject(parent), mediaWidget(NULL),
-	readFd(-1), writeFd(-1)
+	timeShiftPosition(0), videoPid(-1), pipeName(QLatin1String("dvbpipe.m2t")),
+	timeshift(false), readFd(-1), writeFd(-1), notifier(NULL), streamOffset(0),
+	streamInterrupted(false), waitingForRandomAccess(false)
+{
+}
+
+DvbLiveViewInternal::~DvbLiveViewInternal()
+{
+	// the backend mustn't read from the stream anymore
+	setMediaWidget(NULL);
+
+	if (writeFd >= 0) {
+		close(writeFd);
+	}
+
+	if (readFd >= 0) {
+		close(readFd);
+	}
+
+	// the names of the multi view pipes aren't reused
+	if (!url.isEmpty()) {
+		QFile::remove(url.toLocalFile());
+	}
+}
+
+QUrl DvbLiveViewInternal::getUrl() const
+{
+	if (url.isEmpty()) {
+		// the fifo is created on demand
+		const_cast<DvbLiveViewInternal *>(this)->openPipe();
+	}
+
+	return url;
+}
+
+void DvbLiveViewInternal::openPipe()
 {
-	QString fileName = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + QLatin1String("dvbpipe.m2t");
+	QString fileName = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + pipeName;
 	QFile::remove(fileName);
 	url = QUrl::fromLocalFile(fileName);
 
 	if (mkfifo(QFile::encodeName(fileName).constData(), 0600) != 0) {
-		Log("DvbLiveViewInternal::DvbLiveViewInternal: mkfifo failed");
+		Log("DvbLiveViewInternal::openPipe: mkfifo failed");
 		return;
 	}
 
 	readFd = open(QFile::encodeName(fileName).constData(), O_RDONLY | O_NONBLOCK);
 
 	if (readFd < 0) {
-		Log("DvbLiveViewInternal::DvbLiveViewInternal: open failed");
+		Log("DvbLiveViewInternal::openPipe: open failed");
 		return;
 	}
 
-	writeFd = open(QFile::encodeName(fileName).constData(), O_WRONLY | O_NONBLOCK);
+	int fd = open(QFile::encodeName(fileName).constData(), O_WRONLY | O_NONBLOCK);
 
-	if (writeFd < 0) {
-		Log("DvbLiveViewInternal::DvbLiveViewInternal: open failed");
+	if (fd < 0) {
+		Log("DvbLiveViewInternal::openPipe: open failed");
 		return;
 	}
 
-	notifier = new QSocketNotifier(writeFd, QSocketNotifier::Write, this);
+	notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
 	notifier->setEnabled(false);
 	connect(notifier, SIGNAL(activated(int)), this, SLOT(writeToPipe()));
-}
-
-DvbLiveViewInternal::~DvbLiveViewInternal()
-{
-	if (writeFd >= 0) {
-		close(writeFd);
-	}
 
-	if (readFd >= 0) {
-		close(readFd);
-	}
+	QMutexLocker locker(&mutex);
+	writeFd = fd;
 }
 
 void DvbLiveViewInternal::resetPipe()
 {
-	if (!buffers.isEmpty()) {
-		buffer = buffers.at(0);
-		buffers.clear();
-	}
+	QMutexLocker locker(&mutex);
+	freeBuffers.append(buffers);
+	buffers.clear();
+	streamOffset = 0;
 
 	if (readFd >= 0) {
 		if (buffer.isEmpty()) {
@@ -630,11 +717,75 @@ void DvbLiveViewInternal::resetPipe()
 	}
 
 	buffer.clear();
+	waitingForRandomAccess = true;
+	randomAccessTimer.start();
+}
+
+bool DvbLiveViewInternal::isRandomAccessPoint(const char *packet) const
+{
+	if (videoPid < 0) {
+		// radio channel
+		return true;
+	}
+
+	if (((packet[1] & 0x40) == 0) || (((static_cast<unsigned char>(packet[1]) << 8) |
+	    static_cast<unsigned char>(packet[2])) & 0x1fff) != videoPid) {
+		return false;
+	}
+
+	if (randomAccessTimer.elapsed() >= RandomAccessTimeout) {
+		// the random_access_indicator isn't used by every broadcaster
+		return true;
+	}
+
+	// adaptation field with random_access_indicator
+	return (((packet[3] & 0x20) != 0) && (packet[4] != 0) && ((packet[5] & 0x40) != 0));
 }
 
 void DvbLiveViewInternal::writeToPipe()
 {
-	while (!buffers.isEmpty()) {
+	QMutexLocker locker(&mutex);
+
+	while (true) {
+		if (buffers.isEmpty()) {
+			// continue with the data of the time shift buffer
+			if (!timeShiftBuffer.isOpen()) {
+				break;
+			}
+
+			QByteArray chunk;
+
+			if (!freeBuffers.isEmpty()) {
+				chunk = freeBuffers.takeLast();
+			}
+
+			chunk.resize(87 * 188);
+			int bytesRead = timeShiftBuffer.read(timeShiftPosition, chunk.data(), chunk.size());
+
+			if (bytesRead < 0) {
+				qint64 beginPosition = timeShiftBuffer.getBeginPosition();
+
+				if (beginPosition <= timeShiftPosition) {
+					break;
+				}
+
+				Log("DvbLiveViewInternal::writeToPipe: skipping overwritten data") <<
+					(beginPosition - timeShiftPosition);
+				timeShiftPosition = beginPosition;
+				freeBuffers.append(chunk);
+				continue;
+			}
+
+			if (bytesRead == 0) {
+				freeBuffers.append(chunk);
+				break;
+			}
+
+			chunk.resize(bytesRead);
+			timeShiftPosition += bytesRead;
+			buffers.append(chunk);
+		}
+
 		const QByteArray &currentBuffer = buffers.at(0);
 		int bytesWritten = int(write(writeFd, currentBuffer.constData(), currentBuffer.size()));
 
@@ -643,7 +794,7 @@ void DvbLiveViewInternal::writeToPipe()
 		}
 
 		if (bytesWritten == currentBuffer.size()) {
-			buffers.removeFirst();
+			freeBuffers.append(buffers.takeFirst());
 			continue;
 		}
 
@@ -659,23 +810,174 @@ void DvbLiveViewInternal::writeToPipe()
 	}
 }
 
+void DvbLiveViewInternal::seekTimeShift(qint64 offset)
+{
+	QMutexLocker locker(&mutex);
+	qint64 position = qBound(timeShiftBuffer.getBeginPosition(), timeShiftPosition + offset,
+		timeShiftBuffer.getEndPosition());
+	// the backend has to restart at a packet boundary
+	timeShiftPosition = (position - (position % 188));
+
+	// drop the data which hasn't been passed to the backend yet
+	freeBuffers.append(buffers);
+	buffers.clear();
+	streamOffset = 0;
+
+	if (readFd >= 0) {
+		char data[4096];
+
+		while (read(readFd, data, sizeof(data)) > 0) {
+		}
+	}
+}
+
+void DvbLiveViewInternal::openStream()
+{
+	QMutexLocker locker(&mutex);
+	streamInterrupted = false;
+}
+
+int DvbLiveViewInternal::readStream(char *data, int size)
+{
+	QMutexLocker locker(&mutex);
+
+	while (!streamInterrupted) {
+		if (!buffers.isEmpty()) {
+			int bytesRead = 0;
+
+			while ((bytesRead < size) && !buffers.isEmpty()) {
+				const QByteArray &currentBuffer = buffers.at(0);
+				int currentSize = qMin(currentBuffer.size() - streamOffset, size - bytesRead);
+				memcpy(data + bytesRead, currentBuffer.constData() + streamOffset, currentSize);
+				bytesRead += currentSize;
+				streamOffset += currentSize;
+
+				if (streamOffset == currentBuffer.size()) {
+					freeBuffers.append(buffers.takeFirst());
+					streamOffset = 0;
+				}
+			}
+
+			return bytesRead;
+		}
+
+		if (timeShiftBuffer.isOpen()) {
+			// processPackets() mustn't be blocked by disk reads
+			qint64 position = timeShiftPosition;
+			locker.unlock();
+			int bytesRead = timeShiftBuffer.read(position, data, size);
+			locker.relock();
+
+			if (timeShiftPosition != position) {
+				// seekTimeShift() has been called in the meantime
+				continue;
+			}
+
+			if (bytesRead > 0) {
+				timeShiftPosition = (position + bytesRead);
+				return bytesRead;
+			}
+
+			if (bytesRead < 0) {
+				qint64 beginPosition = timeShiftBuffer.getBeginPosition();
+
+				if (beginPosition <= position) {
+					return 0;
+				}
+
+				Log("DvbLiveViewInternal::readStream: skipping overwritten data") <<
+					(beginPosition - position);
+				timeShiftPosition = beginPosition;
+				continue;
+			}
+
+			// data may have arrived while the mutex was unlocked
+			if (timeShiftBuffer.getEndPosition() > position) {
+				continue;
+			}
+		}
+
+		streamCondition.wait(&mutex);
+	}
+
+	return 0;
+}
+
+void DvbLiveViewInternal::interruptStream()
+{
+	QMutexLocker locker(&mutex);
+	streamInterrupted = true;
+	streamCondition.wakeAll();
+}
+
 void DvbLiveViewInternal::processData(const char data[188])
 {
-	buffer.append(data, 188);
+	processPackets(data, 1);
+}
+
+void DvbLiveViewInternal::processPackets(const char *data, int count)
+{
+	QMutexLocker locker(&mutex);
+	bool randomAccessPoint = false;
+
+	if (waitingForRandomAccess) {
+		// the backend can only start decoding at a random access point
+		int index = 0;
+
+		while ((index < count) && !isRandomAccessPoint(data + 188 * index)) {
+			++index;
+		}
+
+		if (index == count) {
+			return;
+		}
+
+		Log("DvbLiveViewInternal::processPackets: random access point after") <<
+			randomAccessTimer.elapsed() << "ms";
+		waitingForRandomAccess = false;
+		randomAccessPoint = true;
+		data += (188 * index);
+		count -= index;
+		buffer.append(patGenerator.generatePackets());
+		buffer.append(pmtGenerator.generatePackets());
+	}
+
+	buffer.append(data, count * 188);
 
-	if (buffer.size() < (87 * 188)) {
+	// the first picture is passed on without delay
+	if ((buffer.size() < (87 * 188)) && !randomAccessPoint) {
 		return;
 	}
 
-	if (!timeShiftFile.isOpen()) {
+	if (!timeShiftBuffer.isOpen()) {
+		buffers.append(buffer);
+
 		if (writeFd >= 0) {
-			buffers.append(buffer);
-			writeToPipe();
+			// the socket notifier may only be used from the main thread
+			if (buffers.size() == 1) {
+				QMetaObject::invokeMethod(this, "writeToPipe", Qt::QueuedConnection);
+			}
+		} else {
+			streamCondition.wakeAll();
+		}
+
+		// the buffers are reused after they have been passed to the backend
+		if (!freeBuffers.isEmpty()) {
+			buffer = freeBuffers.takeLast();
+		} else {
+			buffer = QByteArray();
+			buffer.reserve(87 * 188);
 		}
 	} else {
-		timeShiftFile.write(buffer); // FIXME avoid buffer reallocation
+		timeShiftBuffer.write(buffer.constData(), buffer.size());
+
+		if (writeFd < 0) {
+			streamCondition.wakeAll();
+		} else if (buffers.isEmpty()) {
+			QMetaObject::invokeMethod(this, "writeToPipe", Qt::QueuedConnection);
+		}
 	}
 
-	buffer.clear();
-	buffer.reserve(87 * 188);
+	// keeps the reserved capacity
+	buffer.resize(0);
 }
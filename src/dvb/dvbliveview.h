@@ -21,6 +21,7 @@
 #ifndef DVBLIVEVIEW_H
 #define DVBLIVEVIEW_H
 
+#include <QElapsedTimer>
 #include <QTimer>
 #include "../mediawidget.h"
 #include "dvbchannel.h"
@@ -58,12 +59,14 @@ private slots:
 	void currentAudioStreamChanged(int currentAudioStream);
 	void currentSubtitleChanged(int currentSubtitle);
 	void replay();
+	void skip(int milliseconds);
 	void playbackFinished();
 	void playbackStatusChanged(MediaWidget::PlaybackStatus playbackStatus);
 
 private:
 	void startDevice();
 	void stopDevice();
+	bool startTimeShift();
 	void updatePids(bool forcePatPmtUpdate = false);
 
 	DvbManager *manager;
@@ -76,6 +79,9 @@ private:
 	QList<int> pids;
 	QTimer patPmtTimer;
 	QTimer osdTimer;
+	QElapsedTimer timeShiftTimer;
+	bool switchingChannel; // the ring file is kept across channel changes
+	bool pausedTimeShift; // started by pausing --> all streams are recorded, no selection
 
 	int videoPid;
 	int audioPid;
@@ -21,11 +21,14 @@
 #ifndef DVBLIVEVIEW_P_H
 #define DVBLIVEVIEW_P_H
 
-#include <QFile>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
 #include "../mediawidget.h"
 #include "../osdwidget.h"
 #include "dvbepg.h"
 #include "dvbsi.h"
+#include "dvbtimeshift.h"
 
 class QSocketNotifier;
 
@@ -62,6 +65,7 @@ public:
 	~DvbLiveViewInternal();
 
 	void resetPipe();
+	void seekTimeShift(qint64 offset); // bytes
 
 	MediaWidget *mediaWidget;
 	QString channelName;
@@ -69,8 +73,12 @@ public:
 	QByteArray pmtSectionData;
 	DvbSectionGenerator patGenerator;
 	DvbSectionGenerator pmtGenerator;
+	QMutex mutex; // buffer and timeShiftPosition are also accessed by processPackets() and readStream()
 	QByteArray buffer;
-	QFile timeShiftFile;
+	DvbTimeShiftBuffer timeShiftBuffer;
+	qint64 timeShiftPosition; // next byte of timeShiftBuffer which is passed to the backend
+	int videoPid; // used to find the first random access point
+	QString pipeName; // must be unique if there are several instances
 	DvbOsd dvbOsd;
 
 	bool overrideAudioStreams() const { return !audioStreams.isEmpty(); }
@@ -98,9 +106,16 @@ public:
 
 	Type getType() const { return Dvb; }
 
-	QUrl getUrl() const { return url; }
+	// only used if the backend can't read the stream directly
+	QUrl getUrl() const;
+
+	bool isStream() const { return true; }
+	void openStream();
+	int readStream(char *data, int size);
+	void interruptStream();
 
 	bool hideCurrentTotalTime() const { return !timeshift; }
+	bool canSkip() const { return timeShiftBuffer.isOpen(); }
 
 	bool timeshift;
 	QStringList audioStreams;
@@ -112,6 +127,7 @@ signals:
 	void currentAudioStreamChanged(int currentAudioStream);
 	void currentSubtitleChanged(int currentSubtitle);
 	void replay();
+	void skip(int milliseconds);
 	void playbackFinished();
 	void playbackStatusChanged(MediaWidget::PlaybackStatus playbackStatus);
 	void previous();
@@ -122,12 +138,24 @@ private slots:
 
 private:
 	void processData(const char data[188]);
+	void processPackets(const char *data, int count);
+	void openPipe();
+	bool isRandomAccessPoint(const char *packet) const;
+
+	// after that, the stream starts at the next pes packet of the video pid
+	static const int RandomAccessTimeout = 2000; // milliseconds
 
 	QUrl url;
 	int readFd;
 	int writeFd;
 	QSocketNotifier *notifier;
-	QList<QByteArray> buffers;
+	QList<QByteArray> buffers; // not yet passed to the backend
+	QList<QByteArray> freeBuffers; // can be reused by processPackets()
+	QWaitCondition streamCondition;
+	int streamOffset; // bytes of buffers.first() which have already been read
+	bool streamInterrupted;
+	bool waitingForRandomAccess; // packets are dropped until the first random access point
+	QElapsedTimer randomAccessTimer; // started by resetPipe()
 };
 
 #endif /* DVBLIVEVIEW_P_H */
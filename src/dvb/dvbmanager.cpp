@@ -29,6 +29,7 @@
 #include "../log.h"
 #include "dvbconfig.h"
 #include "dvbdevice.h"
+#include "dvbdevice_file.h"
 #include "dvbdevice_linux.h"
 #include "dvbepg.h"
 #include "dvbliveview.h"
@@ -227,6 +228,18 @@ void DvbManager::updateDeviceConfigs(const QList<DvbDeviceConfigUpdate> &configU
 				}
 
 				deviceConfigs[i].configs = configUpdate.configs;
+				deviceConfigs[i].bufferSize = configUpdate.bufferSize;
+				deviceConfigs[i].bufferCount = configUpdate.bufferCount;
+				deviceConfigs[i].lockBuffers = configUpdate.lockBuffers;
+				deviceConfigs[i].demuxThread = configUpdate.demuxThread;
+
+				if (deviceConfigs.at(i).device != NULL) {
+					deviceConfigs.at(i).device->setDataBuffers(configUpdate.bufferSize,
+						configUpdate.bufferCount, configUpdate.lockBuffers);
+					deviceConfigs.at(i).device->setDemuxThreadEnabled(
+						configUpdate.demuxThread);
+				}
+
 				break;
 			}
 		}
@@ -337,6 +350,16 @@ QString DvbManager::getTimeShiftFolder() const
 	return Configuration::instance()->config()->group("DVB").readEntry("TimeShiftFolder", QDir::homePath());
 }
 
+int DvbManager::getTimeShiftSize() const
+{
+	return qMax(Configuration::instance()->config()->group("DVB").readEntry("TimeShiftSize", 2048), 16);
+}
+
+bool DvbManager::isTimeShiftAlwaysEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("TimeShiftAlways", false);
+}
+
 int DvbManager::getBeginMargin() const
 {
 	return Configuration::instance()->config()->group("DVB").readEntry("BeginMargin", 300);
@@ -352,6 +375,30 @@ bool DvbManager::override6937Charset() const
 	return Configuration::instance()->config()->group("DVB").readEntry("Override6937", false);
 }
 
+// the device access options only take effect after restarting kaffeine
+// (the device managers are set up once)
+
+int DvbManager::getReaderThreadCount() const
+{
+	return qMax(Configuration::instance()->config()->group("DVB").readEntry("ReaderThreads", 0), 0);
+}
+
+QList<int> DvbManager::getReaderThreadCpus() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("ReaderThreadCpus",
+		QList<int>());
+}
+
+bool DvbManager::isSingleDemuxEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("SingleDemux", false);
+}
+
+int DvbManager::getFullTsPidCount() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("FullTsPidCount", 0);
+}
+
 void DvbManager::setRecordingFolder(const QString &path)
 {
 	Configuration::instance()->config()->group("DVB").writeEntry("RecordingFolder", path);
@@ -362,6 +409,16 @@ void DvbManager::setTimeShiftFolder(const QString &path)
 	Configuration::instance()->config()->group("DVB").writeEntry("TimeShiftFolder", path);
 }
 
+void DvbManager::setTimeShiftSize(int timeShiftSize)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("TimeShiftSize", timeShiftSize);
+}
+
+void DvbManager::setTimeShiftAlways(bool enabled)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("TimeShiftAlways", enabled);
+}
+
 void DvbManager::setBeginMargin(int beginMargin)
 {
 	Configuration::instance()->config()->group("DVB").writeEntry("BeginMargin", beginMargin);
@@ -378,6 +435,26 @@ void DvbManager::setOverride6937Charset(bool override)
 	DvbSiText::setOverride6937(override);
 }
 
+void DvbManager::setReaderThreadCount(int threadCount)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("ReaderThreads", threadCount);
+}
+
+void DvbManager::setReaderThreadCpus(const QList<int> &cpus)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("ReaderThreadCpus", cpus);
+}
+
+void DvbManager::setSingleDemuxEnabled(bool enabled)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("SingleDemux", enabled);
+}
+
+void DvbManager::setFullTsPidCount(int pidCount)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("FullTsPidCount", pidCount);
+}
+
 double DvbManager::getLatitude()
 {
 	return Configuration::instance()->config()->group("DVB").readEntry("Latitude", 0.0);
@@ -415,7 +492,10 @@ void DvbManager::enableDvbDump()
 
 void DvbManager::requestBuiltinDeviceManager(QObject *&builtinDeviceManager)
 {
-	builtinDeviceManager = new DvbLinuxDeviceManager(this);
+	DvbLinuxDeviceManager *deviceManager = new DvbLinuxDeviceManager(this);
+	deviceManager->setReaderThreads(getReaderThreadCount(), getReaderThreadCpus());
+	deviceManager->setDemuxOptions(isSingleDemuxEnabled(), getFullTsPidCount());
+	builtinDeviceManager = deviceManager;
 }
 
 void DvbManager::deviceAdded(DvbBackendDevice *backendDevice)
@@ -439,6 +519,8 @@ void DvbManager::deviceAdded(DvbBackendDevice *backendDevice)
 		if ((it.deviceId.isEmpty() || deviceId.isEmpty() || (it.deviceId == deviceId)) &&
 		    (it.frontendName == frontendName) && (it.device == NULL)) {
 			deviceConfigs[i].device = device;
+			device->setDataBuffers(it.bufferSize, it.bufferCount, it.lockBuffers);
+			device->setDemuxThreadEnabled(it.demuxThread);
 			break;
 		}
 	}
@@ -493,11 +575,35 @@ void DvbManager::loadDeviceManager()
 		connect(deviceManager, SIGNAL(deviceRemoved(DvbBackendDevice*)),
 			this, SLOT(deviceRemoved(DvbBackendDevice*)));
 		QMetaObject::invokeMethod(deviceManager, "doColdPlug");
+		loadVirtualDeviceManager();
 		return;
 	}
 
 	Log("DvbManager::loadDeviceManager: using built-in dvb device manager");
 	DvbLinuxDeviceManager *deviceManager = new DvbLinuxDeviceManager(this);
+	deviceManager->setReaderThreads(getReaderThreadCount(), getReaderThreadCpus());
+	deviceManager->setDemuxOptions(isSingleDemuxEnabled(), getFullTsPidCount());
+	connect(deviceManager, SIGNAL(deviceAdded(DvbBackendDevice*)),
+		this, SLOT(deviceAdded(DvbBackendDevice*)));
+	connect(deviceManager, SIGNAL(deviceRemoved(DvbBackendDevice*)),
+		this, SLOT(deviceRemoved(DvbBackendDevice*)));
+	deviceManager->doColdPlug();
+	loadVirtualDeviceManager();
+}
+
+void DvbManager::loadVirtualDeviceManager()
+{
+	KConfigGroup group = Configuration::instance()->config()->group("DVB");
+	QString folder = group.readEntry("VirtualTunerFolder", QString());
+
+	if (folder.isEmpty()) {
+		return;
+	}
+
+	Log("DvbManager::loadVirtualDeviceManager: using virtual tuners for") << folder;
+	DvbFileDeviceManager *deviceManager = new DvbFileDeviceManager(this, folder,
+		qMax(group.readEntry("VirtualTunerCount", 1), 1),
+		group.readEntry("VirtualTunerPaced", true));
 	connect(deviceManager, SIGNAL(deviceAdded(DvbBackendDevice*)),
 		this, SLOT(deviceAdded(DvbBackendDevice*)));
 	connect(deviceManager, SIGNAL(deviceRemoved(DvbBackendDevice*)),
@@ -524,12 +630,22 @@ void DvbManager::readDeviceConfigs()
 		QString deviceId = reader.readString(QLatin1String("deviceId"));
 		QString frontendName = reader.readString(QLatin1String("frontendName"));
 		int configCount = reader.readInt(QLatin1String("configCount"));
+		int bufferSize = reader.readOptionalInt(QLatin1String("bufferSize"),
+			DvbDevice::DefaultBufferSize);
+		int demuxThread = reader.readOptionalInt(QLatin1String("demuxThread"), 0);
+		int bufferCount = reader.readOptionalInt(QLatin1String("bufferCount"),
+			DvbDevice::DefaultBufferCount);
+		int lockBuffers = reader.readOptionalInt(QLatin1String("lockBuffers"), 0);
 
 		if (!reader.isValid()) {
 			break;
 		}
 
 		DvbDeviceConfig deviceConfig(deviceId, frontendName, NULL);
+		deviceConfig.bufferSize = bufferSize;
+		deviceConfig.demuxThread = (demuxThread != 0);
+		deviceConfig.bufferCount = bufferCount;
+		deviceConfig.lockBuffers = (lockBuffers != 0);
 
 		for (int i = 0; i < configCount; ++i) {
 			while (!reader.atEnd()) {
@@ -591,6 +707,10 @@ void DvbManager::writeDeviceConfigs()
 		writer.write(QLatin1String("deviceId"), deviceConfig.deviceId);
 		writer.write(QLatin1String("frontendName"), deviceConfig.frontendName);
 		writer.write(QLatin1String("configCount"), deviceConfig.configs.size());
+		writer.write(QLatin1String("bufferSize"), deviceConfig.bufferSize);
+		writer.write(QLatin1String("demuxThread"), deviceConfig.demuxThread ? 1 : 0);
+		writer.write(QLatin1String("bufferCount"), deviceConfig.bufferCount);
+		writer.write(QLatin1String("lockBuffers"), deviceConfig.lockBuffers ? 1 : 0);
 
 		for (int i = 0; i < deviceConfig.configs.size(); ++i) {
 			const DvbConfig &config = deviceConfig.configs.at(i);
@@ -792,7 +912,9 @@ bool DvbManager::readScanSources(DvbScanData &data, const char *tag, Transmissio
 
 DvbDeviceConfig::DvbDeviceConfig(const QString &deviceId_, const QString &frontendName_,
 	DvbDevice *device_) : deviceId(deviceId_), frontendName(frontendName_), device(device_),
-	useCount(0), prioritizedUseCount(0)
+	bufferSize(DvbDevice::DefaultBufferSize), bufferCount(DvbDevice::DefaultBufferCount),
+	lockBuffers(false), demuxThread(false), useCount(0),
+	prioritizedUseCount(0)
 {
 }
 
@@ -801,7 +923,9 @@ DvbDeviceConfig::~DvbDeviceConfig()
 }
 
 DvbDeviceConfigUpdate::DvbDeviceConfigUpdate(const DvbDeviceConfig *deviceConfig_) :
-	deviceConfig(deviceConfig_)
+	deviceConfig(deviceConfig_), bufferSize(deviceConfig_->bufferSize),
+	bufferCount(deviceConfig_->bufferCount), lockBuffers(deviceConfig_->lockBuffers),
+	demuxThread(deviceConfig_->demuxThread)
 {
 }
 
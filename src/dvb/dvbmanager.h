@@ -122,14 +122,26 @@ public:
 
 	QString getRecordingFolder() const;
 	QString getTimeShiftFolder() const;
+	int getTimeShiftSize() const; // MiB
+	bool isTimeShiftAlwaysEnabled() const;
 	int getBeginMargin() const; // seconds
 	int getEndMargin() const; // seconds
 	bool override6937Charset() const;
+	int getReaderThreadCount() const; // 0 = one reader thread per device
+	QList<int> getReaderThreadCpus() const;
+	bool isSingleDemuxEnabled() const;
+	int getFullTsPidCount() const; // 0 = never
 	void setRecordingFolder(const QString &path);
 	void setTimeShiftFolder(const QString &path);
+	void setTimeShiftSize(int timeShiftSize); // MiB
+	void setTimeShiftAlways(bool enabled);
 	void setBeginMargin(int beginMargin); // seconds
 	void setEndMargin(int endMargin); // seconds
 	void setOverride6937Charset(bool override);
+	void setReaderThreadCount(int threadCount);
+	void setReaderThreadCpus(const QList<int> &cpus);
+	void setSingleDemuxEnabled(bool enabled);
+	void setFullTsPidCount(int pidCount);
 
 	static double getLatitude();
 	static double getLongitude();
@@ -145,6 +157,7 @@ private slots:
 
 private:
 	void loadDeviceManager();
+	void loadVirtualDeviceManager();
 
 	void readDeviceConfigs();
 	void writeDeviceConfigs();
@@ -183,6 +196,10 @@ public:
 	QString frontendName;
 	DvbDevice *device;
 	QList<DvbConfig> configs;
+	int bufferSize; // size of the dvr data buffers (bytes)
+	int bufferCount; // number of preallocated dvr data buffers
+	bool lockBuffers; // keep the dvr data buffers in physical memory
+	bool demuxThread; // process the data in a separate thread
 	int useCount; // -1 means exclusive use
 	int prioritizedUseCount;
 	QString source;
@@ -197,6 +214,10 @@ public:
 
 	const DvbDeviceConfig *deviceConfig;
 	QList<DvbConfig> configs;
+	int bufferSize;
+	int bufferCount;
+	bool lockBuffers;
+	bool demuxThread;
 };
 
 #endif /* DVBMANAGER_H */
@@ -86,6 +86,20 @@ public:
 		return value;
 	}
 
+	int readOptionalInt(const QString &entry, int defaultValue)
+	{
+		// older files don't contain the entry
+		qint64 position = pos();
+
+		if (!readLine().startsWith(entry + QLatin1Char('='))) {
+			seek(position);
+			return defaultValue;
+		}
+
+		seek(position);
+		return readInt(entry);
+	}
+
 	QString readString(const QString &entry)
 	{
 		QString line = readLine();
@@ -0,0 +1,264 @@
+/*
+ * dvbmultiview.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbmultiview.h"
+#include "dvbmultiview_p.h"
+
+#include <QBoxLayout>
+#include <QGridLayout>
+#include <QLabel>
+#include <QSet>
+#include <KLocalizedString>
+#include "../backend-vlc/vlcmediawidget.h"
+#include "../log.h"
+#include "dvbdevice.h"
+#include "dvbliveview_p.h"
+#include "dvbmanager.h"
+
+DvbMultiView::DvbMultiView(DvbManager *manager_, QWidget *parent) : QWidget(parent, Qt::Window),
+	manager(manager_)
+{
+	setWindowTitle(i18nc("@title:window", "Multi View"));
+	gridLayout = new QGridLayout(this);
+	gridLayout->setMargin(0);
+	resize(640, 360);
+}
+
+DvbMultiView::~DvbMultiView()
+{
+	qDeleteAll(entries);
+}
+
+bool DvbMultiView::addChannel(const DvbSharedChannel &channel)
+{
+	foreach (DvbMultiViewEntry *entry, entries) {
+		if (entry->getChannel() == channel) {
+			return true;
+		}
+	}
+
+	if (entries.size() >= MaximumEntries) {
+		// releases the device before a new one is requested
+		delete entries.takeFirst();
+	}
+
+	DvbMultiViewEntry *entry = new DvbMultiViewEntry(manager, channel, this);
+
+	if (!entry->start()) {
+		delete entry;
+		updateLayout();
+		return false;
+	}
+
+	entries.append(entry);
+	updateLayout();
+	return true;
+}
+
+void DvbMultiView::updateLayout()
+{
+	foreach (DvbMultiViewEntry *entry, entries) {
+		gridLayout->removeWidget(entry->getWidget());
+	}
+
+	for (int i = 0; i < entries.size(); ++i) {
+		gridLayout->addWidget(entries.at(i)->getWidget(), i / 2, i % 2);
+	}
+}
+
+DvbMultiViewEntry::DvbMultiViewEntry(DvbManager *manager_, const DvbSharedChannel &channel_,
+	QWidget *parent) : QObject(parent), manager(manager_), channel(channel_), device(NULL)
+{
+	internal = new DvbLiveViewInternal(this);
+	internal->channelName = channel->name;
+	// only used if the backend can't read the stream directly
+	internal->pipeName = QLatin1String("dvbpipe-") + QString::number(quintptr(this), 16) +
+		QLatin1String(".m2t");
+
+	widget = new QWidget(parent);
+	QBoxLayout *boxLayout = new QVBoxLayout(widget);
+	boxLayout->setMargin(0);
+	boxLayout->addWidget(new QLabel(channel->name, widget));
+
+	// the backend isn't connected to a MediaWidget; the live view keeps the controls
+	backend = VlcMediaWidget::createVlcMediaWidget(widget);
+
+	if (backend == NULL) {
+		backend = new DummyMediaWidget(widget);
+	}
+
+	backend->setMuted(true);
+	boxLayout->addWidget(backend, 1);
+
+	connect(&internal->pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
+		this, SLOT(pmtSectionChanged(QByteArray)));
+	connect(&patPmtTimer, SIGNAL(timeout()), this, SLOT(insertPatPmt()));
+}
+
+DvbMultiViewEntry::~DvbMultiViewEntry()
+{
+	if (device != NULL) {
+		stopDevice();
+		manager->releaseDevice(device, DvbManager::Shared);
+	}
+
+	// the backend mustn't read from the stream anymore
+	backend->stop();
+	delete widget;
+}
+
+bool DvbMultiViewEntry::start()
+{
+	device = manager->requestDevice(channel->source, channel->transponder, DvbManager::Shared);
+
+	if (device == NULL) {
+		return false;
+	}
+
+	internal->resetPipe();
+	backend->play(*internal);
+
+	internal->pmtFilter.setProgramNumber(channel->serviceId);
+	startDevice();
+
+	internal->mutex.lock();
+	internal->patGenerator.initPat(channel->transportStreamId, channel->serviceId,
+		channel->pmtPid);
+	internal->buffer.reserve(87 * 188);
+	internal->mutex.unlock();
+
+	pmtSectionChanged(channel->pmtSectionData);
+	patPmtTimer.start(500);
+	return true;
+}
+
+void DvbMultiViewEntry::pmtSectionChanged(const QByteArray &pmtSectionData)
+{
+	internal->pmtSectionData = pmtSectionData;
+	DvbPmtSection pmtSection(internal->pmtSectionData);
+	DvbPmtParser pmtParser(pmtSection);
+	QSet<int> newPids;
+	bool updatePatPmt = false;
+
+	if (pmtParser.videoPid != -1) {
+		newPids.insert(pmtParser.videoPid);
+	}
+
+	// one audio stream is enough
+	if (!pmtParser.audioPids.isEmpty()) {
+		int audioPid = pmtParser.audioPids.at(0).first;
+
+		for (int i = 1; i < pmtParser.audioPids.size(); ++i) {
+			if (pmtParser.audioPids.at(i).first == channel->audioPid) {
+				audioPid = channel->audioPid;
+			}
+		}
+
+		newPids.insert(audioPid);
+	}
+
+	for (int i = 0; i < pids.size(); ++i) {
+		int pid = pids.at(i);
+
+		if (!newPids.remove(pid)) {
+			device->removePidFilter(pid, internal);
+			pids.removeAt(i);
+			updatePatPmt = true;
+			--i;
+		}
+	}
+
+	foreach (int pid, newPids) {
+		device->addPidFilter(pid, internal);
+		pids.append(pid);
+		updatePatPmt = true;
+	}
+
+	// processPackets() uses the generators and the video pid as well
+	internal->mutex.lock();
+	internal->videoPid = pmtParser.videoPid;
+	internal->pmtGenerator.initPmt(channel->pmtPid, pmtSection, pids);
+	internal->mutex.unlock();
+	insertPatPmt();
+
+	if (channel->isScrambled) {
+		device->startDescrambling(internal->pmtSectionData, this);
+	}
+}
+
+void DvbMultiViewEntry::insertPatPmt()
+{
+	QMutexLocker locker(&internal->mutex);
+	internal->buffer.append(internal->patGenerator.generatePackets());
+	internal->buffer.append(internal->pmtGenerator.generatePackets());
+}
+
+void DvbMultiViewEntry::deviceStateChanged()
+{
+	switch (device->getDeviceState()) {
+	case DvbDevice::DeviceReleased:
+		stopDevice();
+		device = manager->requestDevice(channel->source, channel->transponder,
+			DvbManager::Shared);
+
+		if (device != NULL) {
+			startDevice();
+		} else {
+			Log("DvbMultiViewEntry::deviceStateChanged: no available device found");
+			patPmtTimer.stop();
+			backend->stop();
+		}
+
+		break;
+	case DvbDevice::DeviceIdle:
+	case DvbDevice::DeviceRotorMoving:
+	case DvbDevice::DeviceTuning:
+	case DvbDevice::DeviceTuned:
+		break;
+	}
+}
+
+void DvbMultiViewEntry::startDevice()
+{
+	foreach (int pid, pids) {
+		device->addPidFilter(pid, internal);
+	}
+
+	device->addSectionFilter(channel->pmtPid, &internal->pmtFilter);
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+
+	if (channel->isScrambled && !internal->pmtSectionData.isEmpty()) {
+		device->startDescrambling(internal->pmtSectionData, this);
+	}
+}
+
+void DvbMultiViewEntry::stopDevice()
+{
+	if (channel->isScrambled && !internal->pmtSectionData.isEmpty()) {
+		device->stopDescrambling(internal->pmtSectionData, this);
+	}
+
+	foreach (int pid, pids) {
+		device->removePidFilter(pid, internal);
+	}
+
+	device->removeSectionFilter(channel->pmtPid, &internal->pmtFilter);
+	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+}
@@ -0,0 +1,54 @@
+/*
+ * dvbmultiview.h
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBMULTIVIEW_H
+#define DVBMULTIVIEW_H
+
+#include <QWidget>
+#include "dvbchannel.h"
+
+class QGridLayout;
+class DvbManager;
+class DvbMultiViewEntry;
+
+// shows further channels next to the live view; channels on the same transponder
+// share the device (and thus the demux pass) with the live view and with each other
+
+class DvbMultiView : public QWidget
+{
+public:
+	DvbMultiView(DvbManager *manager_, QWidget *parent);
+	~DvbMultiView();
+
+	// the oldest channel is replaced if the view is full; returns false if no device is available
+	bool addChannel(const DvbSharedChannel &channel);
+
+	// in addition to the live view
+	static const int MaximumEntries = 3;
+
+private:
+	void updateLayout();
+
+	DvbManager *manager;
+	QGridLayout *gridLayout;
+	QList<DvbMultiViewEntry *> entries;
+};
+
+#endif /* DVBMULTIVIEW_H */
@@ -0,0 +1,70 @@
+/*
+ * dvbmultiview_p.h
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBMULTIVIEW_P_H
+#define DVBMULTIVIEW_P_H
+
+#include <QTimer>
+#include "dvbchannel.h"
+
+class AbstractMediaWidget;
+class DvbDevice;
+class DvbLiveViewInternal;
+class DvbManager;
+
+class DvbMultiViewEntry : public QObject
+{
+	Q_OBJECT
+public:
+	DvbMultiViewEntry(DvbManager *manager_, const DvbSharedChannel &channel_, QWidget *parent);
+	~DvbMultiViewEntry();
+
+	bool start();
+
+	const DvbSharedChannel &getChannel() const
+	{
+		return channel;
+	}
+
+	QWidget *getWidget() const
+	{
+		return widget;
+	}
+
+private slots:
+	void pmtSectionChanged(const QByteArray &pmtSectionData);
+	void insertPatPmt();
+	void deviceStateChanged();
+
+private:
+	void startDevice();
+	void stopDevice();
+
+	DvbManager *manager;
+	DvbSharedChannel channel;
+	DvbDevice *device;
+	DvbLiveViewInternal *internal;
+	QWidget *widget;
+	AbstractMediaWidget *backend;
+	QList<int> pids;
+	QTimer patPmtTimer;
+};
+
+#endif /* DVBMULTIVIEW_P_H */
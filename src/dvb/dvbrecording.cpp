@@ -529,6 +529,7 @@ void DvbRecordingFile::pmtSectionChanged(const QByteArray &pmtSectionData_)
 	pmtGenerator.initPmt(channel->pmtPid, pmtSection, pids);
 
 	if (!pmtValid) {
+		QMutexLocker locker(&mutex);
 		pmtValid = true;
 		file.write(patGenerator.generatePackets());
 		file.write(pmtGenerator.generatePackets());
@@ -555,22 +556,30 @@ void DvbRecordingFile::insertPatPmt()
 		return;
 	}
 
+	QMutexLocker locker(&mutex);
 	file.write(patGenerator.generatePackets());
 	file.write(pmtGenerator.generatePackets());
 }
 
 void DvbRecordingFile::processData(const char data[188])
 {
+	processPackets(data, 1);
+}
+
+void DvbRecordingFile::processPackets(const char *data, int count)
+{
+	QMutexLocker locker(&mutex);
+
 	if (!pmtValid) {
-		if (!patPmtTimer.isActive()) {
-			patPmtTimer.start(1000);
+		// the pids are added shortly before the pmt becomes valid
+		if (buffers.isEmpty()) {
 			QByteArray nextBuffer;
 			nextBuffer.reserve(348 * 188);
 			buffers.append(nextBuffer);
 		}
 
 		QByteArray &buffer = buffers.last();
-		buffer.append(data, 188);
+		buffer.append(data, count * 188);
 
 		if (buffer.size() >= (348 * 188)) {
 			QByteArray nextBuffer;
@@ -581,5 +590,5 @@ void DvbRecordingFile::processData(const char data[188])
 		return;
 	}
 
-	file.write(data, 188);
+	file.write(data, count * 188);
 }
@@ -22,6 +22,7 @@
 #define DVBRECORDING_P_H
 
 #include <QFile>
+#include <QMutex>
 #include <QTimer>
 #include "dvbchannel.h"
 #include "dvbsi.h"
@@ -48,9 +49,11 @@ private slots:
 
 private:
 	void processData(const char data[188]);
+	void processPackets(const char *data, int count);
 
 	DvbManager *manager;
 	DvbSharedChannel channel;
+	QMutex mutex; // file, buffers and pmtValid are also accessed by processPackets()
 	QFile file;
 	QList<QByteArray> buffers;
 	DvbDevice *device;
@@ -22,6 +22,7 @@
 
 #include <QTextCodec>
 #include "../log.h"
+#include "dvbcrc.h"
 
 void DvbSection::initSection(const char *data, int size)
 {
@@ -42,100 +43,9 @@ void DvbSection::initSection(const char *data, int size)
 
 int DvbStandardSection::verifyCrc32(const char *data, int size)
 {
-	unsigned int crc32 = 0xffffffff;
-
-	for (int i = 0; i < size; ++i) {
-		crc32 = ((crc32 << 8) ^ crc32Table[(crc32 >> 24) ^ quint8(data[i])]);
-	}
-
-	return crc32;
+	return DvbCrc32::compute(data, size);
 }
 
-/*
- * unsigned int crc32TableValue(int index)
- * {
- * 	unsigned int value = 0;
- *
- * 	for (int i = 8; i >= 0; --i) {
- * 		if (((value & 0x80000000) != 0) ^ ((index & (1 << i)) != 0)) {
- * 			value = (value << 1) ^ 0x04c11db7;
- * 		} else {
- * 			value <<= 1;
- * 		}
- * 	}
- *
- * 	return value;
- * }
- */
-
-const unsigned int DvbStandardSection::crc32Table[] =
-{
-	0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9,
-	0x130476dc, 0x17c56b6b, 0x1a864db2, 0x1e475005,
-	0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
-	0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd,
-	0x4c11db70, 0x48d0c6c7, 0x4593e01e, 0x4152fda9,
-	0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
-	0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011,
-	0x791d4014, 0x7ddc5da3, 0x709f7b7a, 0x745e66cd,
-	0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
-	0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5,
-	0xbe2b5b58, 0xbaea46ef, 0xb7a96036, 0xb3687d81,
-	0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
-	0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49,
-	0xc7361b4c, 0xc3f706fb, 0xceb42022, 0xca753d95,
-	0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
-	0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d,
-	0x34867077, 0x30476dc0, 0x3d044b19, 0x39c556ae,
-	0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
-	0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16,
-	0x018aeb13, 0x054bf6a4, 0x0808d07d, 0x0cc9cdca,
-	0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
-	0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02,
-	0x5e9f46bf, 0x5a5e5b08, 0x571d7dd1, 0x53dc6066,
-	0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
-	0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e,
-	0xbfa1b04b, 0xbb60adfc, 0xb6238b25, 0xb2e29692,
-	0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
-	0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a,
-	0xe0b41de7, 0xe4750050, 0xe9362689, 0xedf73b3e,
-	0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
-	0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686,
-	0xd5b88683, 0xd1799b34, 0xdc3abded, 0xd8fba05a,
-	0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
-	0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb,
-	0x4f040d56, 0x4bc510e1, 0x46863638, 0x42472b8f,
-	0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
-	0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47,
-	0x36194d42, 0x32d850f5, 0x3f9b762c, 0x3b5a6b9b,
-	0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
-	0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623,
-	0xf12f560e, 0xf5ee4bb9, 0xf8ad6d60, 0xfc6c70d7,
-	0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
-	0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f,
-	0xc423cd6a, 0xc0e2d0dd, 0xcda1f604, 0xc960ebb3,
-	0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
-	0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b,
-	0x9b3660c6, 0x9ff77d71, 0x92b45ba8, 0x9675461f,
-	0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
-	0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640,
-	0x4e8ee645, 0x4a4ffbf2, 0x470cdd2b, 0x43cdc09c,
-	0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
-	0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24,
-	0x119b4be9, 0x155a565e, 0x18197087, 0x1cd86d30,
-	0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
-	0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088,
-	0x2497d08d, 0x2056cd3a, 0x2d15ebe3, 0x29d4f654,
-	0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
-	0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c,
-	0xe3a1cbc1, 0xe760d676, 0xea23f0af, 0xeee2ed18,
-	0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
-	0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0,
-	0x9abc8bd5, 0x9e7d9662, 0x933eb0bb, 0x97ffad0c,
-	0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
-	0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
-};
-
 void DvbStandardSection::initStandardSection(const char *data, int size)
 {
 	if (size < 12) {
@@ -236,6 +146,42 @@ const unsigned short Iso6937Codec::table[] = {
 };
 
 QString DvbSiText::convertText(const char *data, int size)
+{
+	if ((size < 1) || (size > MaximumCachedSize)) {
+		return decodeText(data, size);
+	}
+
+	int index = (qHash(QByteArray::fromRawData(data, size)) & (CacheSize - 1));
+	QByteArray &cachedDataEntry = cachedData[index];
+
+	if ((cachedDataEntry.size() == size) &&
+	    (memcmp(cachedDataEntry.constData(), data, size) == 0)) {
+		return cachedTexts[index];
+	}
+
+	QString text = decodeText(data, size);
+	cachedDataEntry = QByteArray(data, size);
+	cachedTexts[index] = text;
+	return text;
+}
+
+void DvbSiText::setOverride6937(bool override)
+{
+	if (override6937 != override) {
+		override6937 = override;
+		clearCache();
+	}
+}
+
+void DvbSiText::clearCache()
+{
+	for (int i = 0; i < CacheSize; ++i) {
+		cachedData[i].clear();
+		cachedTexts[i].clear();
+	}
+}
+
+QString DvbSiText::decodeText(const char *data, int size)
 {
 	if (size < 1) {
 		return QString();
@@ -299,6 +245,11 @@ QString DvbSiText::convertText(const char *data, int size)
 		size--;
 	}
 
+	if (isAscii(data, size)) {
+		// all supported encodings are supersets of ascii
+		return QString::fromLatin1(data, size);
+	}
+
 	if (codecTable[encoding] == NULL) {
 		QTextCodec *codec = NULL;
 
@@ -341,7 +292,14 @@ QString DvbSiText::convertText(const char *data, int size)
 			}
 		}
 
-		QString result = codecTable[encoding]->toUnicode(dest, int(destIt - dest));
+		QString result;
+
+		if (encoding == Iso8859_1) {
+			result = QString::fromLatin1(dest, int(destIt - dest));
+		} else {
+			result = codecTable[encoding]->toUnicode(dest, int(destIt - dest));
+		}
+
 		delete[] dest;
 
 		return result;
@@ -350,13 +308,33 @@ QString DvbSiText::convertText(const char *data, int size)
 	return codecTable[encoding]->toUnicode(data, size);
 }
 
-void DvbSiText::setOverride6937(bool override)
+bool DvbSiText::isAscii(const char *data, int size)
 {
-	override6937 = override;
+	const char *end = (data + size);
+
+	// eight bytes at a time
+	for (; (end - data) >= 8; data += 8) {
+		quint64 value;
+		memcpy(&value, data, sizeof(value));
+
+		if ((value & Q_UINT64_C(0x8080808080808080)) != 0) {
+			return false;
+		}
+	}
+
+	for (; data != end; ++data) {
+		if (quint8(*data) >= 0x80) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 QTextCodec *DvbSiText::codecTable[EncodingTypeMax + 1] = { NULL };
 bool DvbSiText::override6937 = false;
+QByteArray DvbSiText::cachedData[CacheSize];
+QString DvbSiText::cachedTexts[CacheSize];
 
 void DvbDescriptor::initDescriptor(const char *data, int size)
 {
@@ -477,6 +455,41 @@ QString AtscPsipText::convertText(const char *data, int size)
 	return result;
 }
 
+// decodes up to eight bits at once: for every context (previous character) and every
+// 8 bit prefix the table contains either the character and the length of its code
+// (length << 8 | character) or the tree node reached after eight bits (0x8000 | node)
+
+class AtscHuffmanLookupTable
+{
+public:
+	AtscHuffmanLookupTable(const unsigned short *offsets, const unsigned char *tableBase)
+	{
+		for (int context = 0; context < 128; ++context) {
+			const unsigned char *table = (tableBase + offsets[context]);
+
+			for (int prefix = 0; prefix < 256; ++prefix) {
+				int index = 0;
+				int bitCount = 0;
+
+				do {
+					index = table[2 * index + ((prefix >> (7 - bitCount)) & 0x1)];
+					++bitCount;
+				} while ((index < 128) && (bitCount < 8));
+
+				if (index >= 128) {
+					entries[context][prefix] = ((bitCount << 8) | (index & 0x7f));
+				} else {
+					entries[context][prefix] = (0x8000 | index);
+				}
+			}
+		}
+	}
+
+	~AtscHuffmanLookupTable() { }
+
+	unsigned short entries[128][256];
+};
+
 QString AtscHuffmanString::convertText(const char *data_, int length, int table)
 {
 	AtscHuffmanString huffmanstring(data_, length, table);
@@ -484,8 +497,15 @@ QString AtscHuffmanString::convertText(const char *data_, int length, int table)
 	return huffmanstring.result;
 }
 
-AtscHuffmanString::AtscHuffmanString(const char *data_, int length, int table) : data(data_),
-	bitsLeft(8 * length)
+QString AtscHuffmanString::convertTextBitwise(const char *data_, int length, int table)
+{
+	AtscHuffmanString huffmanstring(data_, length, table);
+	huffmanstring.decompressBitwise();
+	return huffmanstring.result;
+}
+
+AtscHuffmanString::AtscHuffmanString(const char *data_, int length_, int table) : data(data_),
+	length(length_), bitsLeft(8 * length_)
 {
 	if (table == 1) {
 		offsets = Huffman1Offsets;
@@ -494,6 +514,19 @@ AtscHuffmanString::AtscHuffmanString(const char *data_, int length, int table) :
 		offsets = Huffman2Offsets;
 		tableBase = Huffman2Tables;
 	}
+
+	lookupTable = getLookupTable(table);
+}
+
+const unsigned short (*AtscHuffmanString::getLookupTable(int table))[256]
+{
+	if (table == 1) {
+		static const AtscHuffmanLookupTable lookupTable1(Huffman1Offsets, Huffman1Tables);
+		return lookupTable1.entries;
+	}
+
+	static const AtscHuffmanLookupTable lookupTable2(Huffman2Offsets, Huffman2Tables);
+	return lookupTable2.entries;
 }
 
 AtscHuffmanString::~AtscHuffmanString() { }
@@ -535,7 +568,80 @@ unsigned char AtscHuffmanString::getByte()
 	return 0;
 }
 
+int AtscHuffmanString::peekByte(int position) const
+{
+	int index = (position >> 3);
+	int value = 0;
+
+	if (index < length) {
+		value = (quint8(data[index]) << 8);
+
+		if ((index + 1) < length) {
+			value |= quint8(data[index + 1]);
+		}
+	}
+
+	return ((value >> (8 - (position & 0x7))) & 0xff);
+}
+
 void AtscHuffmanString::decompress()
+{
+	// same behaviour as decompressBitwise(), but working on the lookup table
+	int position = 0;
+	int bitCount = bitsLeft;
+	int context = 0;
+
+	while (position < bitCount) {
+		int entry = lookupTable[context][peekByte(position)];
+		int index;
+
+		if (entry < 0x8000) {
+			position += (entry >> 8);
+			index = (entry & 0x7f);
+		} else {
+			// the code is longer than eight bits
+			const unsigned char *table = (tableBase + offsets[context]);
+			position += 8;
+			index = (entry & 0x7fff);
+
+			do {
+				index = table[2 * index + ((peekByte(position) >> 7) & 0x1)];
+				++position;
+			} while (index < 128);
+
+			index &= 0x7f;
+		}
+
+		if (index == 27) {
+			// escape --> uncompressed character(s)
+			while (true) {
+				if ((bitCount - position) < 8) {
+					index = 0;
+					break;
+				}
+
+				index = peekByte(position);
+				position += 8;
+
+				if (index < 128) {
+					break;
+				}
+
+				result += QChar(index);
+			}
+		}
+
+		if (index == 0) {
+			// end
+			break;
+		}
+
+		result += QChar(index);
+		context = index;
+	}
+}
+
+void AtscHuffmanString::decompressBitwise()
 {
 	const unsigned char *table = tableBase;
 
@@ -1048,7 +1154,8 @@ void DvbSectionGenerator::initPat(int transportStreamId, int programNumber, int
 	data[9] = char(programNumber);
 	data[10] = 0xe0 | char(pmtPid >> 8);
 	data[11] = char(pmtPid);
-	endSection(16, 0x00);
+	endSection(16);
+	endTable(0x00);
 }
 
 void DvbSectionGenerator::initPmt(int pmtPid, const DvbPmtSection &section, const QList<int> &pids)
@@ -1070,10 +1177,11 @@ void DvbSectionGenerator::initPmt(int pmtPid, const DvbPmtSection &section, cons
 		entry.advance();
 	}
 
-	endSection(size + 4, pmtPid);
+	endSection(size + 4);
+	endTable(pmtPid);
 }
 
-QByteArray DvbSectionGenerator::generatePackets()
+const QByteArray &DvbSectionGenerator::generatePackets()
 {
 	char *data = packets.data();
 
@@ -1085,60 +1193,99 @@ QByteArray DvbSectionGenerator::generatePackets()
 	return packets;
 }
 
+void DvbSectionGenerator::appendSection(int pid, const char *data, int size)
+{
+	Q_ASSERT((size >= 4) && (size <= 0x1002));
+	Q_ASSERT((pid >= 0) && (pid <= 0x1fff));
+
+	// the first packet contains the pointer field
+	int packetCount = (((size + 1) + 183) / 184);
+	int offset = packets.size();
+	packets.resize(offset + (packetCount * 188));
+	char *packet = (packets.data() + offset);
+
+	for (int i = 0; i < packetCount; ++i) {
+		packet[0] = 0x47;
+		packet[1] = char(((i == 0) ? 0x40 : 0x00) | (pid >> 8));
+		packet[2] = char(pid);
+		packet[3] = 0x10; // continuity counter is filled out in generatePackets()
+		int headerSize = 4;
+
+		if (i == 0) {
+			packet[4] = 0x00;
+			headerSize = 5;
+		}
+
+		int payloadSize = qMin(188 - headerSize, size);
+		memcpy(packet + headerSize, data, payloadSize);
+		memset(packet + headerSize + payloadSize, 0xff, 188 - headerSize - payloadSize);
+		data += payloadSize;
+		size -= payloadSize;
+		packet += 188;
+	}
+}
+
 char *DvbSectionGenerator::startSection(int sectionLength)
 {
 	Q_ASSERT((sectionLength >= 4) && (sectionLength <= 0x1002));
-	packets.resize(((sectionLength / 184) + 1) * 188);
-	return packets.data() + 5;
+	sectionStart = table.size();
+	table.resize(sectionStart + sectionLength);
+	char *data = (table.data() + sectionStart);
+	memset(data, 0, qMin(sectionLength, 8));
+	data[1] = 0xb0;
+	return data;
 }
 
-void DvbSectionGenerator::endSection(int sectionLength, int pid)
+void DvbSectionGenerator::endSection(int sectionLength)
+{
+	Q_ASSERT((sectionLength >= 12) && (sectionLength <= 0x1002));
+	Q_ASSERT((sectionStart + sectionLength) <= table.size());
+
+	table.resize(sectionStart + sectionLength);
+	char *data = (table.data() + sectionStart);
+
+	data[1] = (data[1] & 0xf0) | char((sectionLength - 3) >> 8);
+	data[2] = char(sectionLength - 3);
+	// the version number and the crc are filled out in endTable()
+	data[5] = 0x00;
+	memset(data + sectionLength - 4, 0, 4);
+}
+
+void DvbSectionGenerator::endTable(int pid)
 {
-	Q_ASSERT((sectionLength >= 4) && (sectionLength <= 0x1002));
 	Q_ASSERT((pid >= 0) && (pid <= 0x1fff));
 
-	packets.resize(((sectionLength / 184) + 1) * 188);
-	char *data = packets.data();
+	if ((pid == tablePid) && (table == lastTable) && !packets.isEmpty()) {
+		// nothing has changed --> keep the packets and the version number
+		table.clear();
+		return;
+	}
+
+	if (!packets.isEmpty()) {
+		versionNumber = (versionNumber + 1) & 0x1f;
+	}
+
+	lastTable = table;
+	tablePid = pid;
+	packets.clear();
+	char *data = table.data();
+
+	for (int offset = 0; offset < table.size();) {
+		char *section = (data + offset);
+		int size = ((((quint8(section[1]) & 0x0f) << 8) | quint8(section[2])) + 3);
+
+		section[5] = 0xc1 | char(versionNumber << 1);
+		quint32 crc32 = DvbCrc32::compute(section, size - 4);
+		section[size - 4] = char(crc32 >> 24);
+		section[size - 3] = char(crc32 >> 16);
+		section[size - 2] = char(crc32 >> 8);
+		section[size - 1] = char(crc32);
+
+		appendSection(pid, section, size);
+		offset += size;
+	}
 
-	data[0] = 0x47;
-	data[1] = 0x40 | char(pid >> 8);
-	data[2] = char(pid);
-	data[3] = 0x10;
-	data[4] = 0x00;
-	data[6] = 0xb0 | char((sectionLength - 3) >> 8);
-	data[7] = char(sectionLength - 3);
-	data[10] = 0xc1 | char(versionNumber << 1);
-	data[11] = 0x00;
-	data[12] = 0x00;
-
-	int size = sectionLength + 5;
-	unsigned int crc32 = 0xffffffff;
-
-	for (int i = 5; i < (size - 4); ++i) {
-		unsigned char byte = data[i];
-		crc32 = (crc32 << 8) ^ DvbStandardSection::crc32Table[(crc32 >> 24) ^ byte];
-	}
-
-	data[size - 4] = char(crc32 >> 24);
-	data[size - 3] = char(crc32 >> 16);
-	data[size - 2] = char(crc32 >> 8);
-	data[size - 1] = char(crc32);
-
-	for (int i = 188; i < size; i += 188) {
-		// split the section into multiple packets if necessary
-		memmove(data + i + 4, data + i, size - i);
-		data[i] = 0x47;
-		data[i + 1] = char(pid >> 8);
-		data[i + 2] = char(pid);
-		data[i + 3] = 0x10; // continuity counter is filled out in generatePackets()
-		size += 4;
-	}
-
-	// pad the unused bytes
-	memset(data + size, 0xff, packets.size() - size);
-
-	// increment version number
-	versionNumber = (versionNumber + 1) & 0x1f;
+	table.clear();
 }
 
 DvbPmtParser::DvbPmtParser(const DvbPmtSection &section) : videoPid(-1), teletextPid(-1)
@@ -136,7 +136,6 @@ public:
 	}
 
 	static int verifyCrc32(const char *data, int size);
-	static const unsigned int crc32Table[];
 
 protected:
 	DvbStandardSection() { }
@@ -148,13 +147,21 @@ private:
 	Q_DISABLE_COPY(DvbStandardSection)
 };
 
+// decoded texts are cached (identical texts share the same string); not thread-safe
+
 class DvbSiText
 {
 public:
 	static QString convertText(const char *data, int size);
 	static void setOverride6937(bool override);
+	static void clearCache();
 
 private:
+	enum {
+		CacheSize = 256, // must be a power of two
+		MaximumCachedSize = 256 // longer texts (usually descriptions) aren't cached
+	};
+
 	enum TextEncoding
 	{
 		Iso6937		=  0,
@@ -178,8 +185,13 @@ private:
 		EncodingTypeMax	= 17
 	};
 
+	static QString decodeText(const char *data, int size);
+	static bool isAscii(const char *data, int size);
+
 	static QTextCodec *codecTable[EncodingTypeMax + 1];
 	static bool override6937;
+	static QByteArray cachedData[CacheSize];
+	static QString cachedTexts[CacheSize];
 };
 
 class DvbDescriptor : public DvbSectionData
@@ -197,9 +209,22 @@ public:
 		return at(0);
 	}
 
+	// the common case (a complete descriptor) is handled inline
 	void advance()
 	{
-		initDescriptor(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 2) {
+			int descriptorLength = (quint8(data[1]) + 2);
+
+			if (descriptorLength <= size) {
+				initSectionData(data, descriptorLength, size);
+				return;
+			}
+		}
+
+		initDescriptor(data, size);
 	}
 
 	static int bcdToInt(unsigned int bcd, int multiplier)
@@ -235,20 +260,30 @@ class AtscHuffmanString
 {
 public:
 	static QString convertText(const char *data_, int size, int table);
+
+	// reference implementation (one bit at a time); for testing and benchmarking
+	static QString convertTextBitwise(const char *data_, int size, int table);
+
 private:
 	AtscHuffmanString(const char *data_, int size, int table);
 	~AtscHuffmanString();
 	bool hasBits();
 	unsigned char getBit();
 	unsigned char getByte();
+	int peekByte(int position) const; // missing bits are zero
 	void decompress();
+	void decompressBitwise();
+
+	static const unsigned short (*getLookupTable(int table))[256];
 
 	const char *data;
+	int length;
 	int bitsLeft;
 
 	QString result;
 	const unsigned short *offsets;
 	const unsigned char *tableBase;
+	const unsigned short (*lookupTable)[256];
 
 	static const unsigned short Huffman1Offsets[128];
 	static const unsigned char Huffman1Tables[];
@@ -275,35 +310,55 @@ signals:
 private:
 	void processSection(const char *data, int size);
 
+	bool isChangesOnly() const
+	{
+		return true;
+	}
+
 	int programNumber;
 	QByteArray lastPmtSectionData;
 };
 
+// the packets are kept between calls; they are only rebuilt if the content of the table changes
+// (then the version number is incremented), otherwise only the continuity counters are updated
+
 class DvbSectionGenerator
 {
 public:
-	DvbSectionGenerator() : versionNumber(0), continuityCounter(0) { }
+	DvbSectionGenerator() : tablePid(-1), versionNumber(0), continuityCounter(0),
+		sectionStart(0) { }
 	~DvbSectionGenerator() { }
 
 	void initPat(int transportStreamId, int programNumber, int pmtPid);
 	void initPmt(int pmtPid, const DvbPmtSection &section, const QList<int> &pids);
 
+	// appends a complete section (including the crc); all sections have to use the same pid
+	void appendSection(int pid, const char *data, int size);
+
 	void reset()
 	{
 		packets.clear();
+		lastTable.clear();
+		tablePid = -1;
 		versionNumber = 0;
 		continuityCounter = 0;
 	}
 
-	QByteArray generatePackets();
+	// the returned packets stay valid until the generator is modified
+	const QByteArray &generatePackets();
 
 private:
 	char *startSection(int sectionLength);
-	void endSection(int sectionLength, int pid);
+	void endSection(int sectionLength);
+	void endTable(int pid);
 
 	QByteArray packets;
+	QByteArray table; // the sections which are currently built
+	QByteArray lastTable; // without version number and crc
+	int tablePid;
 	int versionNumber;
 	int continuityCounter;
+	int sectionStart;
 };
 
 class DvbPmtParser
@@ -630,9 +685,18 @@ public:
 
 	~DvbPatSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initPatSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 4) {
+			initSectionData(data, 4, size);
+			return;
+		}
+
+		initPatSectionEntry(data, size);
 	}
 
 	int programNumber() const
@@ -659,9 +723,22 @@ public:
 
 	~DvbPmtSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initPmtSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 5) {
+			int entryLength = ((((quint8(data[3]) & 0xf) << 8) | quint8(data[4])) + 5);
+
+			if (entryLength <= size) {
+				initSectionData(data, entryLength, size);
+				return;
+			}
+		}
+
+		initPmtSectionEntry(data, size);
 	}
 
 	int streamType() const
@@ -693,9 +770,22 @@ public:
 
 	~DvbSdtSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initSdtSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 5) {
+			int entryLength = ((((quint8(data[3]) & 0xf) << 8) | quint8(data[4])) + 5);
+
+			if (entryLength <= size) {
+				initSectionData(data, entryLength, size);
+				return;
+			}
+		}
+
+		initSdtSectionEntry(data, size);
 	}
 
 	int serviceId() const
@@ -727,9 +817,22 @@ public:
 
 	~DvbEitSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initEitSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 12) {
+			int entryLength = ((((quint8(data[10]) & 0xf) << 8) | quint8(data[11])) + 12);
+
+			if (entryLength <= size) {
+				initSectionData(data, entryLength, size);
+				return;
+			}
+		}
+
+		initEitSectionEntry(data, size);
 	}
 
 	int startDate() const
@@ -766,9 +869,22 @@ public:
 
 	~DvbNitSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initNitSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 6) {
+			int entryLength = ((((quint8(data[4]) & 0xf) << 8) | quint8(data[5])) + 6);
+
+			if (entryLength <= size) {
+				initSectionData(data, entryLength, size);
+				return;
+			}
+		}
+
+		initNitSectionEntry(data, size);
 	}
 
 	DvbDescriptor descriptors() const
@@ -790,9 +906,22 @@ public:
 
 	~AtscMgtSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initMgtSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 11) {
+			int entryLength = ((((quint8(data[9]) & 0xf) << 8) | quint8(data[10])) + 11);
+
+			if (entryLength <= size) {
+				initSectionData(data, entryLength, size);
+				return;
+			}
+		}
+
+		initMgtSectionEntry(data, size);
 	}
 
 	int tableType() const
@@ -824,9 +953,22 @@ public:
 
 	~AtscVctSectionEntry() { }
 
+	// the common case (a complete entry) is handled inline
 	void advance()
 	{
-		initVctSectionEntry(getData() + getLength(), getSize() - getLength());
+		const char *data = (getData() + getLength());
+		int size = (getSize() - getLength());
+
+		if (size >= 32) {
+			int entryLength = ((((quint8(data[30]) & 0x3) << 8) | quint8(data[31])) + 32);
+
+			if (entryLength <= size) {
+				initSectionData(data, entryLength, size);
+				return;
+			}
+		}
+
+		initVctSectionEntry(data, size);
 	}
 
 	int shortName1() const
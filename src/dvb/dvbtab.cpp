@@ -41,6 +41,7 @@
 #include "dvbepgdialog.h"
 #include "dvbliveview.h"
 #include "dvbmanager.h"
+#include "dvbmultiview.h"
 #include "dvbrecordingdialog.h"
 #include "dvbscandialog.h"
 
@@ -156,6 +157,11 @@ DvbTab::DvbTab(QMenu *menu, KActionCollection *collection, MediaWidget *mediaWid
 
 	channelView->setSortingEnabled(true);
 	channelView->addEditAction();
+
+	QAction *multiViewAction = new QAction(QIcon::fromTheme(QLatin1String("view-split-left-right")),
+		i18nc("@action", "Show in Multi View"), channelView);
+	connect(multiViewAction, SIGNAL(triggered()), this, SLOT(showInMultiView()));
+	channelView->addAction(multiViewAction);
 	connect(channelView, SIGNAL(activated(QModelIndex)), this, SLOT(playChannel(QModelIndex)));
 	channelProxyModel->setChannelModel(manager->getChannelModel());
 	connect(lineEdit, SIGNAL(textChanged(QString)),
@@ -412,6 +418,25 @@ void DvbTab::playChannel(const QModelIndex &index)
 	}
 }
 
+void DvbTab::showInMultiView()
+{
+	QModelIndex index = channelView->currentIndex();
+
+	if (!index.isValid()) {
+		return;
+	}
+
+	if (multiView.isNull()) {
+		multiView = new DvbMultiView(manager, this);
+		multiView->setAttribute(Qt::WA_DeleteOnClose, true);
+		multiView->show();
+	}
+
+	if (!multiView->addChannel(channelProxyModel->value(index))) {
+		KMessageBox::information(this, i18nc("@info", "No device found."));
+	}
+}
+
 void DvbTab::previousChannel()
 {
 	QModelIndex index = channelView->currentIndex();
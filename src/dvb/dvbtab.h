@@ -36,6 +36,7 @@ class QMenu;
 class DvbChannelTableModel;
 class DvbChannelView;
 class DvbEpgDialog;
+class DvbMultiView;
 class DvbTimeShiftCleaner;
 class MediaWidget;
 
@@ -72,6 +73,7 @@ private slots:
 	void configureDvb();
 	void tuneOsdChannel();
 	void playChannel(const QModelIndex &index);
+	void showInMultiView();
 	void previousChannel();
 	void nextChannel();
 	void cleanTimeShiftFiles();
@@ -88,6 +90,7 @@ private:
 	DvbChannelTableModel *channelProxyModel;
 	DvbChannelView *channelView;
 	QPointer<DvbEpgDialog> epgDialog;
+	QPointer<DvbMultiView> multiView;
 	QLayout *mediaLayout;
 	QString osdChannel;
 	QTimer osdChannelTimer;
@@ -0,0 +1,320 @@
+/*
+ * dvbtimeshift.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbtimeshift.h"
+
+#include <QFile>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h> // bsd compatibility
+#include <sys/types.h> // bsd compatibility
+#include <unistd.h>
+#include "../log.h"
+
+// if the disk can't keep up, the data is dropped instead of using more and more memory
+static const int MaximumPendingBlocks = 32;
+
+DvbTimeShiftBuffer::DvbTimeShiftBuffer() : fd(-1), capacity(0), flushedPosition(0),
+	endPosition(0), activeReaders(0), writing(false), stopped(false), overflow(false)
+{
+}
+
+DvbTimeShiftBuffer::~DvbTimeShiftBuffer()
+{
+	close();
+}
+
+bool DvbTimeShiftBuffer::open(const QString &fileName_, qint64 size)
+{
+	close();
+
+	// at least four blocks, so that writing and reading don't get in each other's way
+	qint64 newCapacity = (qMax(size, qint64(4 * BlockSize)) / BlockSize) * BlockSize;
+	int newFd = ::open(QFile::encodeName(fileName_).constData(),
+		O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+	if (newFd < 0) {
+		Log("DvbTimeShiftBuffer::open: cannot open file") << fileName_;
+		return false;
+	}
+
+	// reserve the space now; the ring file never grows afterwards
+	bool reserved = false;
+#ifdef Q_OS_LINUX
+	if (fallocate(newFd, 0, 0, newCapacity) == 0) {
+		reserved = true;
+	} else if (errno == ENOSPC) {
+		Log("DvbTimeShiftBuffer::open: not enough space") << fileName_ << newCapacity;
+		::close(newFd);
+		QFile::remove(fileName_);
+		return false;
+	}
+#endif
+
+	// fall back to a sparse file (e.g. if the file system doesn't support fallocate)
+	if (!reserved && (ftruncate(newFd, newCapacity) != 0)) {
+		Log("DvbTimeShiftBuffer::open: cannot resize file") << fileName_;
+		::close(newFd);
+		QFile::remove(fileName_);
+		return false;
+	}
+
+	QMutexLocker locker(&mutex);
+	name = fileName_;
+	fd = newFd;
+	capacity = newCapacity;
+	flushedPosition = 0;
+	endPosition = 0;
+	stopped = false;
+	overflow = false;
+	locker.unlock();
+
+	start();
+	return true;
+}
+
+void DvbTimeShiftBuffer::close()
+{
+	QMutexLocker locker(&mutex);
+
+	if (fd < 0) {
+		return;
+	}
+
+	stopped = true;
+	condition.wakeAll();
+	locker.unlock();
+
+	wait();
+
+	locker.relock();
+
+	while (activeReaders > 0) {
+		condition.wait(&mutex);
+	}
+
+	::close(fd);
+	fd = -1;
+	blocks.clear();
+	freeBlocks.clear();
+
+	// DvbTab::cleanTimeShiftFiles() only has to deal with files left over by a crash
+	if (!QFile::remove(name)) {
+		Log("DvbTimeShiftBuffer::close: cannot remove file") << name;
+	}
+}
+
+void DvbTimeShiftBuffer::clear()
+{
+	QMutexLocker locker(&mutex);
+
+	if (fd < 0) {
+		return;
+	}
+
+	while (writing || (activeReaders > 0)) {
+		condition.wait(&mutex);
+	}
+
+	freeBlocks.append(blocks);
+	blocks.clear();
+	flushedPosition = 0;
+	endPosition = 0;
+	overflow = false;
+}
+
+bool DvbTimeShiftBuffer::isOpen() const
+{
+	QMutexLocker locker(&mutex);
+	return (fd >= 0);
+}
+
+void DvbTimeShiftBuffer::write(const char *data, int size)
+{
+	QMutexLocker locker(&mutex);
+
+	if (fd < 0) {
+		return;
+	}
+
+	while (size > 0) {
+		if (blocks.isEmpty() || (blocks.last().size() == BlockSize)) {
+			if (blocks.size() >= MaximumPendingBlocks) {
+				if (!overflow) {
+					Log("DvbTimeShiftBuffer::write: disk is too slow, dropping data");
+					overflow = true;
+				}
+
+				return;
+			}
+
+			if (!freeBlocks.isEmpty()) {
+				blocks.append(freeBlocks.takeLast());
+				blocks.last().resize(0);
+			} else {
+				QByteArray block;
+				block.reserve(BlockSize);
+				blocks.append(block);
+			}
+		}
+
+		QByteArray &block = blocks.last();
+		int currentSize = qMin(size, BlockSize - block.size());
+		block.append(data, currentSize);
+		data += currentSize;
+		size -= currentSize;
+		endPosition += currentSize;
+
+		if (block.size() == BlockSize) {
+			condition.wakeAll();
+		}
+	}
+
+	overflow = false;
+}
+
+qint64 DvbTimeShiftBuffer::getBeginPosition() const
+{
+	QMutexLocker locker(&mutex);
+	return beginPosition();
+}
+
+qint64 DvbTimeShiftBuffer::getEndPosition() const
+{
+	QMutexLocker locker(&mutex);
+	return endPosition;
+}
+
+int DvbTimeShiftBuffer::read(qint64 position, char *data, int size)
+{
+	QMutexLocker locker(&mutex);
+
+	if ((fd < 0) || (position < beginPosition())) {
+		return -1;
+	}
+
+	if (position >= endPosition) {
+		return 0;
+	}
+
+	if (position >= flushedPosition) {
+		// the data hasn't been written yet
+		int index = int((position - flushedPosition) / BlockSize);
+		int offset = int((position - flushedPosition) % BlockSize);
+		int bytesRead = 0;
+
+		while ((bytesRead < size) && (index < blocks.size())) {
+			const QByteArray &block = blocks.at(index);
+			int currentSize = qMin(block.size() - offset, size - bytesRead);
+			memcpy(data + bytesRead, block.constData() + offset, currentSize);
+			bytesRead += currentSize;
+			offset = 0;
+			++index;
+		}
+
+		return bytesRead;
+	}
+
+	// don't read across the end of the file or into the blocks in memory
+	qint64 offset = (position % capacity);
+	int bytesRead = int(qMin(qint64(size), qMin(flushedPosition - position, capacity - offset)));
+	++activeReaders;
+	locker.unlock();
+
+	int result = 0;
+
+	for (int done = 0; done < bytesRead;) {
+		result = int(pread(fd, data + done, bytesRead - done, offset + done));
+
+		if (result > 0) {
+			done += result;
+		} else if ((result < 0) && (errno == EINTR)) {
+			continue;
+		} else {
+			break;
+		}
+	}
+
+	locker.relock();
+	--activeReaders;
+	condition.wakeAll();
+
+	if (result <= 0) {
+		Log("DvbTimeShiftBuffer::read: cannot read from file") << name;
+		return -1;
+	}
+
+	// the data may have been overwritten in the meantime
+	if (position < beginPosition()) {
+		return -1;
+	}
+
+	return bytesRead;
+}
+
+void DvbTimeShiftBuffer::run()
+{
+	QMutexLocker locker(&mutex);
+
+	while (true) {
+		while (!stopped && (blocks.isEmpty() || (blocks.first().size() < BlockSize))) {
+			condition.wait(&mutex);
+		}
+
+		if (stopped) {
+			break;
+		}
+
+		// the block stays readable until it has been written
+		QByteArray block = blocks.first();
+		qint64 offset = (flushedPosition % capacity);
+		writing = true;
+		locker.unlock();
+
+		// the capacity is a multiple of the block size --> blocks never wrap around
+		for (int done = 0; done < BlockSize;) {
+			int result = int(pwrite(fd, block.constData() + done, BlockSize - done,
+				offset + done));
+
+			if (result > 0) {
+				done += result;
+			} else if ((result < 0) && (errno == EINTR)) {
+				continue;
+			} else {
+				Log("DvbTimeShiftBuffer::run: cannot write to file") << name;
+				break;
+			}
+		}
+
+		locker.relock();
+		writing = false;
+		condition.wakeAll();
+		blocks.removeFirst();
+		freeBlocks.append(block);
+		flushedPosition += BlockSize;
+	}
+}
+
+// the next written block overwrites the oldest block in the file
+
+qint64 DvbTimeShiftBuffer::beginPosition() const
+{
+	return qMax(qint64(0), flushedPosition + BlockSize - capacity);
+}
@@ -0,0 +1,86 @@
+/*
+ * dvbtimeshift.h
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBTIMESHIFT_H
+#define DVBTIMESHIFT_H
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+// a fixed-size ring file; the oldest data is overwritten once the file is full
+// write() only queues the data, it is written to the file by a background thread
+// positions are counted from the beginning of the time shift (they don't wrap around)
+
+class DvbTimeShiftBuffer : private QThread
+{
+public:
+	DvbTimeShiftBuffer();
+	~DvbTimeShiftBuffer();
+
+	// the size is rounded down to whole blocks; the file must not exist yet
+	bool open(const QString &fileName_, qint64 size);
+	void close(); // also removes the file
+
+	// discards the data, but keeps the (already reserved) file for reuse
+	void clear();
+
+	bool isOpen() const;
+
+	QString fileName() const
+	{
+		return name;
+	}
+
+	void write(const char *data, int size);
+
+	// older data has already been overwritten
+	qint64 getBeginPosition() const;
+	qint64 getEndPosition() const;
+
+	// returns the number of bytes read (0 = no data available yet)
+	// or -1 if the data at 'position' has already been overwritten
+	int read(qint64 position, char *data, int size);
+
+	// all writes use this size (and are aligned to it); it is a multiple of 188 and 4096
+	static const int BlockSize = (188 * 4096);
+
+private:
+	Q_DISABLE_COPY(DvbTimeShiftBuffer)
+
+	void run();
+	qint64 beginPosition() const;
+
+	QString name;
+	int fd;
+	qint64 capacity;
+	mutable QMutex mutex;
+	QWaitCondition condition;
+	QList<QByteArray> blocks; // not yet written; blocks.first() starts at flushedPosition
+	QList<QByteArray> freeBlocks;
+	qint64 flushedPosition;
+	qint64 endPosition;
+	int activeReaders; // close() and clear() wait for them
+	bool writing; // clear() waits until the current block has been written
+	bool stopped;
+	bool overflow;
+};
+
+#endif /* DVBTIMESHIFT_H */
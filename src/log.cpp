@@ -20,111 +20,388 @@
 
 #include "log.h"
 
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QMutex>
 #include <QTextCodec>
-#include <QTime>
+#include <QThread>
+#include <QThreadStorage>
+#include <QWaitCondition>
 #include <stdio.h>
 
-class LogPrivate
+class LogEntry
 {
 public:
-	LogPrivate() : position(0)
-	{
-		buffer.reserve(8176);
-	}
+	LogEntry() : time(0), message(NULL) { }
+	~LogEntry() { }
+
+	qint64 time; // msecs since epoch
+	const char *message;
+	QString arguments;
+};
+
+// the messages of a thread; filled by the thread itself and drained by the writer thread
+
+class LogThreadData
+{
+public:
+	enum {
+		Capacity = 256 // must be a power of two
+	};
+
+	LogThreadData() : readIndex(0), writeIndex(0), droppedCount(0), finished(0) { }
+	~LogThreadData() { }
 
-	~LogPrivate()
+	// producer side; moves the current entry into the ring
+	void push()
 	{
+		int index = writeIndex.load();
+		int nextIndex = ((index + 1) & (Capacity - 1));
+
+		if (nextIndex == readIndex.loadAcquire()) {
+			droppedCount.ref();
+			current.arguments.clear();
+			return;
+		}
+
+		LogEntry &entry = entries[index];
+		entry.time = current.time;
+		entry.message = current.message;
+		qSwap(entry.arguments, current.arguments);
+		writeIndex.storeRelease(nextIndex);
 	}
 
-	void begin(const char *message)
+	// consumer side; returns false if the ring is empty
+	bool pop(LogEntry *entry)
 	{
-		mutex.lock();
+		int index = readIndex.load();
 
-		if (buffer.size() > (8176 - 1024)) {
-			buffer.remove(0, buffer.indexOf(QLatin1Char('\n'), 1023) + 1);
+		if (index == writeIndex.loadAcquire()) {
+			return false;
 		}
 
-		position = buffer.size();
-		buffer.append(QTime::currentTime().toString(Qt::ISODate));
-		buffer.append(QLatin1Char(' '));
-		buffer.append(QLatin1String(message));
+		LogEntry &ringEntry = entries[index];
+		entry->time = ringEntry.time;
+		entry->message = ringEntry.message;
+		entry->arguments = ringEntry.arguments;
+		ringEntry.arguments.clear();
+		readIndex.storeRelease((index + 1) & (Capacity - 1));
+		return true;
 	}
 
-	void append(qint64 value)
+	LogEntry current; // only accessed by the producer
+	QAtomicInt readIndex;
+	QAtomicInt writeIndex;
+	QAtomicInt droppedCount;
+	QAtomicInt finished; // set when the thread has exited
+
+private:
+	Q_DISABLE_COPY(LogThreadData)
+
+	LogEntry entries[Capacity];
+};
+
+class LogThreadHandle
+{
+public:
+	explicit LogThreadHandle(LogThreadData *threadData_) : threadData(threadData_) { }
+
+	~LogThreadHandle()
 	{
-		buffer.append(QLatin1Char(' '));
-		buffer.append(QString::number(value));
+		// the writer thread deletes the data after draining it
+		threadData->finished.storeRelease(1);
 	}
 
-	void append(quint64 value)
+	LogThreadData *threadData;
+};
+
+class LogCallSite
+{
+public:
+	LogCallSite() : message(NULL), second(0), count(0), suppressedCount(0) { }
+	~LogCallSite() { }
+
+	QAtomicPointer<const char> message;
+	QAtomicInt second; // start of the current interval
+	QAtomicInt count; // messages in the current interval
+	QAtomicInt suppressedCount;
+};
+
+static bool logEntryLessThan(const LogEntry &x, const LogEntry &y)
+{
+	return (x.time < y.time);
+}
+
+// writes the messages of all threads in the background (or directly after shutdown)
+
+class LogPrivate : public QThread
+{
+public:
+	enum {
+		CallSiteCount = 1024, // must be a power of two
+		MaximumRate = 10, // messages per call site and second
+		HistorySize = 8176
+	};
+
+	LogPrivate() : stopped(0)
 	{
-		buffer.append(QLatin1Char(' '));
-		buffer.append(QString::number(value));
+		history.reserve(HistorySize + 1024);
 	}
 
-	void append(const QString &string)
-	{
-		buffer.append(QLatin1String(" \""));
-		buffer.append(string);
-		buffer.append(QLatin1Char('"'));
+	~LogPrivate() { }
+
+	static void shutdown();
+
+	bool checkRate(const char *message, qint64 time);
+	LogThreadData *getThreadData();
+	void flush();
+
+	QMutex mutex; // protects history and serializes flush()
+	QString history;
+	QAtomicInt stopped;
+
+private:
+	void run();
+	void appendSuppressedCounts(QList<LogEntry> &entries, qint64 time);
+
+	LogCallSite callSites[CallSiteCount];
+	QThreadStorage<LogThreadHandle *> threadHandles;
+	QMutex threadMutex; // protects threadDatas
+	QList<LogThreadData *> threadDatas;
+	QMutex waitMutex;
+	QWaitCondition waitCondition;
+};
+
+void LogPrivate::shutdown()
+{
+	LogPrivate *data = Log::data.load();
+	data->waitMutex.lock();
+	data->stopped.storeRelease(1);
+	data->waitCondition.wakeAll();
+	data->waitMutex.unlock();
+	data->wait();
+	data->flush();
+}
+
+bool LogPrivate::checkRate(const char *message, qint64 time)
+{
+	int second = int(time / 1000);
+	quint32 hash = (quint32(quintptr(message) >> 2) * 2654435761U);
+
+	for (int i = 0; i < CallSiteCount; ++i) {
+		LogCallSite &callSite = callSites[(hash + i) & (CallSiteCount - 1)];
+		const char *callSiteMessage = callSite.message.loadAcquire();
+
+		if ((callSiteMessage == NULL) && callSite.message.testAndSetOrdered(NULL, message)) {
+			callSiteMessage = message;
+		} else if (callSiteMessage == NULL) {
+			// another thread has taken the entry
+			callSiteMessage = callSite.message.loadAcquire();
+		}
+
+		if (callSiteMessage != message) {
+			continue;
+		}
+
+		int callSiteSecond = callSite.second.loadAcquire();
+
+		if ((callSiteSecond != second) &&
+		    callSite.second.testAndSetOrdered(callSiteSecond, second)) {
+			callSite.count.storeRelease(0);
+		}
+
+		if (callSite.count.fetchAndAddOrdered(1) < MaximumRate) {
+			return true;
+		}
+
+		callSite.suppressedCount.ref();
+		return false;
 	}
 
-	void end()
-	{
-		buffer.append(QLatin1Char('\n'));
-		fprintf(stderr, "%s", QTextCodec::codecForLocale()->fromUnicode(
-			buffer.constData() + position, buffer.size() - position).constData());
-		mutex.unlock();
+	// too many call sites; no rate limiting
+	return true;
+}
+
+LogThreadData *LogPrivate::getThreadData()
+{
+	LogThreadHandle *handle = threadHandles.localData();
+
+	if (handle == NULL) {
+		handle = new LogThreadHandle(new LogThreadData());
+		threadMutex.lock();
+		threadDatas.append(handle->threadData);
+		threadMutex.unlock();
+		threadHandles.setLocalData(handle);
 	}
 
-	QMutex mutex;
-	QString buffer;
-	int position;
-};
+	return handle->threadData;
+}
+
+void LogPrivate::flush()
+{
+	QMutexLocker locker(&mutex);
+	qint64 time = QDateTime::currentMSecsSinceEpoch();
+	threadMutex.lock();
+	QList<LogThreadData *> currentThreadDatas = threadDatas;
+	threadMutex.unlock();
+	QList<LogEntry> entries;
+	LogEntry entry;
+
+	foreach (LogThreadData *threadData, currentThreadDatas) {
+		bool finished = (threadData->finished.loadAcquire() != 0);
+
+		while (threadData->pop(&entry)) {
+			entries.append(entry);
+		}
+
+		int droppedCount = threadData->droppedCount.fetchAndStoreOrdered(0);
+
+		if (droppedCount > 0) {
+			entry.time = time;
+			entry.message = "LogPrivate::flush: messages dropped";
+			entry.arguments = (QLatin1Char(' ') + QString::number(droppedCount));
+			entries.append(entry);
+		}
+
+		if (finished) {
+			threadMutex.lock();
+			threadDatas.removeOne(threadData);
+			threadMutex.unlock();
+			delete threadData;
+		}
+	}
+
+	appendSuppressedCounts(entries, time);
+
+	if (entries.isEmpty()) {
+		return;
+	}
+
+	qStableSort(entries.begin(), entries.end(), logEntryLessThan);
+	QString lines;
+
+	foreach (const LogEntry &currentEntry, entries) {
+		lines.append(QDateTime::fromMSecsSinceEpoch(currentEntry.time).time().toString(
+			Qt::ISODate));
+		lines.append(QLatin1Char(' '));
+		lines.append(QLatin1String(currentEntry.message));
+		lines.append(currentEntry.arguments);
+		lines.append(QLatin1Char('\n'));
+	}
+
+	fprintf(stderr, "%s", QTextCodec::codecForLocale()->fromUnicode(lines).constData());
+	history.append(lines);
+
+	if (history.size() > HistorySize) {
+		history.remove(0, history.indexOf(QLatin1Char('\n'), history.size() - HistorySize) + 1);
+	}
+}
+
+void LogPrivate::run()
+{
+	waitMutex.lock();
+
+	while (stopped.loadAcquire() == 0) {
+		waitCondition.wait(&waitMutex, 100);
+		waitMutex.unlock();
+		flush();
+		waitMutex.lock();
+	}
+
+	waitMutex.unlock();
+}
+
+void LogPrivate::appendSuppressedCounts(QList<LogEntry> &entries, qint64 time)
+{
+	int second = int(time / 1000);
+
+	for (int i = 0; i < CallSiteCount; ++i) {
+		LogCallSite &callSite = callSites[i];
+
+		// summarize once the interval is over
+		if ((callSite.suppressedCount.loadAcquire() == 0) ||
+		    (callSite.second.loadAcquire() == second)) {
+			continue;
+		}
+
+		int suppressedCount = callSite.suppressedCount.fetchAndStoreOrdered(0);
+
+		if (suppressedCount > 0) {
+			LogEntry entry;
+			entry.time = time;
+			entry.message = callSite.message.loadAcquire();
+			entry.arguments = (QLatin1String(" (") + QString::number(suppressedCount) +
+				QLatin1String(" similar messages suppressed)"));
+			entries.append(entry);
+		}
+	}
+}
 
 QString Log::getLog()
 {
 	if (data != NULL) {
 		QMutexLocker locker(&data.load()->mutex);
-		return data.load()->buffer;
+		return data.load()->history;
 	}
 
 	return QString();
 }
 
-void Log::begin(const char *message)
+LogThreadData *Log::begin(const char *message)
 {
 	if (data == NULL) {
 		LogPrivate *newData = new LogPrivate();
 
-		if (!data.testAndSetOrdered(NULL, newData)) {
+		if (data.testAndSetOrdered(NULL, newData)) {
+			newData->start(QThread::LowPriority);
+			qAddPostRoutine(LogPrivate::shutdown);
+		} else {
 			// another thread won the battle
 			delete newData;
 		}
 	}
 
-	data.load()->begin(message);
+	LogPrivate *logPrivate = data.load();
+	qint64 time = QDateTime::currentMSecsSinceEpoch();
+
+	if (!logPrivate->checkRate(message, time)) {
+		return NULL;
+	}
+
+	LogThreadData *threadData = logPrivate->getThreadData();
+	threadData->current.time = time;
+	threadData->current.message = message;
+	return threadData;
 }
 
-void Log::append(qint64 value)
+void Log::append(LogThreadData *threadData, qint64 value)
 {
-	data.load()->append(value);
+	threadData->current.arguments.append(QLatin1Char(' '));
+	threadData->current.arguments.append(QString::number(value));
 }
 
-void Log::append(quint64 value)
+void Log::append(LogThreadData *threadData, quint64 value)
 {
-	data.load()->append(value);
+	threadData->current.arguments.append(QLatin1Char(' '));
+	threadData->current.arguments.append(QString::number(value));
 }
 
-void Log::append(const QString &string)
+void Log::append(LogThreadData *threadData, const QString &string)
 {
-	data.load()->append(string);
+	threadData->current.arguments.append(QLatin1String(" \""));
+	threadData->current.arguments.append(string);
+	threadData->current.arguments.append(QLatin1Char('"'));
 }
 
-void Log::end()
+void Log::end(LogThreadData *threadData)
 {
-	data.load()->end();
+	threadData->push();
+	LogPrivate *logPrivate = data.load();
+
+	if (logPrivate->stopped.loadAcquire() != 0) {
+		// the writer thread isn't running anymore
+		logPrivate->flush();
+	}
 }
 
 QBasicAtomicPointer<LogPrivate> Log::data = Q_BASIC_ATOMIC_INITIALIZER(0);
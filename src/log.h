@@ -24,62 +24,84 @@
 #include <QString>
 
 class LogPrivate;
+class LogThreadData;
+
+// messages are collected per thread and written by a background thread; the message
+// string identifies the call site and has to be a literal (used for rate limiting)
 
 class Log
 {
 public:
-	Log(const char *message)
-	{
-		begin(message);
-	}
+	Log(const char *message) : threadData(begin(message)) { }
 
 	~Log()
 	{
-		end();
+		if (threadData != NULL) {
+			end(threadData);
+		}
 	}
 
 	static QString getLog();
 
 	Log &operator<<(qint32 value)
 	{
-		append(qint64(value));
+		if (threadData != NULL) {
+			append(threadData, qint64(value));
+		}
+
 		return (*this);
 	}
 
 	Log &operator<<(quint32 value)
 	{
-		append(quint64(value));
+		if (threadData != NULL) {
+			append(threadData, quint64(value));
+		}
+
 		return (*this);
 	}
 
 	Log &operator<<(qint64 value)
 	{
-		append(value);
+		if (threadData != NULL) {
+			append(threadData, value);
+		}
+
 		return (*this);
 	}
 
 	Log &operator<<(quint64 value)
 	{
-		append(value);
+		if (threadData != NULL) {
+			append(threadData, value);
+		}
+
 		return (*this);
 	}
 
 	Log &operator<<(const QString &string)
 	{
-		append(string);
+		if (threadData != NULL) {
+			append(threadData, string);
+		}
+
 		return (*this);
 	}
 
 private:
 	Q_DISABLE_COPY(Log)
+	friend class LogPrivate;
 
-	static void begin(const char *message);
-	static void append(qint64 value);
-	static void append(quint64 value);
-	static void append(const QString &string);
-	static void end();
+	// returns NULL if the message is suppressed
+	static LogThreadData *begin(const char *message);
+	static void append(LogThreadData *threadData, qint64 value);
+	static void append(LogThreadData *threadData, quint64 value);
+	static void append(LogThreadData *threadData, const QString &string);
+	static void end(LogThreadData *threadData);
 
 	static QBasicAtomicPointer<LogPrivate> data;
+
+	LogThreadData *threadData;
 };
 
 #endif /* LOG_H */
@@ -458,6 +458,11 @@ void MediaWidget::play(MediaSource *source_)
 void MediaWidget::mediaSourceDestroyed(MediaSource *mediaSource)
 {
 	if (source == mediaSource) {
+		if (mediaSource->isStream()) {
+			// the backend mustn't read from the stream anymore
+			backend->stop();
+		}
+
 		source = dummySource.data();
 	}
 }
@@ -789,6 +794,12 @@ void MediaWidget::timeButtonClicked()
 void MediaWidget::longSkipBackward()
 {
 	int longSkipDuration = Configuration::instance()->getLongSkipDuration();
+
+	if (source->canSkip()) {
+		source->skip(-1000 * longSkipDuration);
+		return;
+	}
+
 	int currentTime = (backend->getCurrentTime() - 1000 * longSkipDuration);
 
 	if (currentTime < 0) {
@@ -801,6 +812,12 @@ void MediaWidget::longSkipBackward()
 void MediaWidget::shortSkipBackward()
 {
 	int shortSkipDuration = Configuration::instance()->getShortSkipDuration();
+
+	if (source->canSkip()) {
+		source->skip(-1000 * shortSkipDuration);
+		return;
+	}
+
 	int currentTime = (backend->getCurrentTime() - 1000 * shortSkipDuration);
 
 	if (currentTime < 0) {
@@ -813,12 +830,24 @@ void MediaWidget::shortSkipBackward()
 void MediaWidget::shortSkipForward()
 {
 	int shortSkipDuration = Configuration::instance()->getShortSkipDuration();
+
+	if (source->canSkip()) {
+		source->skip(1000 * shortSkipDuration);
+		return;
+	}
+
 	backend->seek(backend->getCurrentTime() + 1000 * shortSkipDuration);
 }
 
 void MediaWidget::longSkipForward()
 {
 	int longSkipDuration = Configuration::instance()->getLongSkipDuration();
+
+	if (source->canSkip()) {
+		source->skip(1000 * longSkipDuration);
+		return;
+	}
+
 	backend->seek(backend->getCurrentTime() + 1000 * longSkipDuration);
 }
 
@@ -1003,7 +1032,7 @@ void MediaWidget::seekableChanged()
 {
 	bool seekable = (backend->isSeekable() && !source->hideCurrentTotalTime());
 	seekSlider->setEnabled(seekable);
-	navigationMenu->setEnabled(seekable);
+	navigationMenu->setEnabled(seekable || source->canSkip());
 	jumpToPositionAction->setEnabled(seekable);
 }
 
@@ -269,6 +269,18 @@ public:
 	virtual void replay() { weakMediaWidget->play(this); }
 	virtual void previous() { }
 	virtual void next() { }
+	// the source skips within the media itself (e.g. dvb time shift); negative = backward
+	virtual bool canSkip() const { return false; }
+	virtual void skip(int ) { } // milliseconds
+
+	// the backend may read the data directly instead of opening getUrl()
+	virtual bool isStream() const { return false; }
+	// openStream() and readStream() are called from a backend thread; readStream() blocks
+	// until data is available and returns the number of bytes read (0 = end of stream)
+	virtual void openStream() { }
+	virtual int readStream(char *, int ) { return 0; }
+	// wakes up readStream(), which returns 0 until the stream is opened again
+	virtual void interruptStream() { }
 
 	void setMediaWidget(MediaWidget *mediaWidget)
 	{
@@ -0,0 +1,704 @@
+/*
+ * generatets.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// synthesizes a multi-program transport stream (dvb-t) for load tests and benchmarks;
+// the same parameters (including the start date) always produce the same output
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDate>
+#include <QDebug>
+#include <QFile>
+#include <QMap>
+#include <QVector>
+#include "../src/dvb/dvbcrc.h"
+#include "../src/dvb/dvbsi.h"
+
+class Random
+{
+public:
+	explicit Random(quint32 seed) : value(seed) { }
+	~Random() { }
+
+	quint32 next()
+	{
+		// xorshift32 (the state must not be zero)
+		value ^= (value << 13);
+		value ^= (value >> 17);
+		value ^= (value << 5);
+		return value;
+	}
+
+	// true with the given probability
+	bool chance(double probability)
+	{
+		return ((next() / 4294967296.0) < probability);
+	}
+
+private:
+	quint32 value;
+};
+
+// builds a standard section (the section length and the crc are filled out by finish())
+
+class SectionBuilder
+{
+public:
+	SectionBuilder(int tableId, int tableIdExtension, int versionNumber, int sectionNumber,
+		int lastSectionNumber)
+	{
+		data.append(char(tableId));
+		data.append(char(0xb0));
+		data.append(char(0x00));
+		appendShort(tableIdExtension);
+		data.append(char(0xc1 | (versionNumber << 1)));
+		data.append(char(sectionNumber));
+		data.append(char(lastSectionNumber));
+	}
+
+	~SectionBuilder() { }
+
+	void appendByte(int value)
+	{
+		data.append(char(value));
+	}
+
+	void appendShort(int value)
+	{
+		data.append(char(value >> 8));
+		data.append(char(value));
+	}
+
+	void appendData(const QByteArray &value)
+	{
+		data.append(value);
+	}
+
+	// starts a 12 bit length field (for example descriptors_loop_length)
+	int beginLength()
+	{
+		data.append(char(0xf0));
+		data.append(char(0x00));
+		return data.size();
+	}
+
+	void endLength(int position)
+	{
+		int length = (data.size() - position);
+		data[position - 2] = char((data.at(position - 2) & 0xf0) | (length >> 8));
+		data[position - 1] = char(length);
+	}
+
+	QByteArray finish()
+	{
+		int sectionLength = (data.size() + 4 - 3);
+		data[1] = char(0xb0 | (sectionLength >> 8));
+		data[2] = char(sectionLength);
+		quint32 crc32 = DvbCrc32::compute(data.constData(), data.size());
+		data.append(char(crc32 >> 24));
+		data.append(char(crc32 >> 16));
+		data.append(char(crc32 >> 8));
+		data.append(char(crc32));
+		return data;
+	}
+
+private:
+	QByteArray data;
+};
+
+static QByteArray descriptor(int tag, const QByteArray &content)
+{
+	Q_ASSERT(content.size() <= 255);
+	return (char(tag) + (char(content.size()) + content));
+}
+
+static QByteArray lengthPrefixed(const QByteArray &text)
+{
+	return (char(text.size()) + text);
+}
+
+static int toBcd(int value)
+{
+	return (((value / 10) << 4) | (value % 10));
+}
+
+// a table (or a part of it) with its own repetition interval
+
+class Carousel
+{
+public:
+	Carousel() : interval(0), nextPacket(0) { }
+	~Carousel() { }
+
+	DvbSectionGenerator generator;
+	qint64 interval; // in packets
+	qint64 nextPacket;
+};
+
+class TsGenerator
+{
+public:
+	TsGenerator(int serviceCount_, int bitrate, int eventCount_, const QDate &startDate_,
+		quint32 seed) : serviceCount(serviceCount_), eventCount(eventCount_),
+		startDate(startDate_), random(seed),
+		continuityCounters(8192, 0), packetIndex(0), siPosition(0)
+	{
+		packetRate = ((bitrate * 1000.0) / (188 * 8));
+	}
+
+	~TsGenerator()
+	{
+		qDeleteAll(carousels);
+	}
+
+	void init();
+	QByteArray generate(qint64 packetCount, double ccErrorRate, double teiRate);
+
+private:
+	enum {
+		TransportStreamId = 0x0401,
+		OriginalNetworkId = 0x2114,
+		NetworkId = 0x3001,
+		SectionsPerSegment = 8, // a segment covers three hours
+		MaximumEventsSize = 1000 // per eit section
+	};
+
+	static int pmtPid(int service)
+	{
+		return (0x0100 + (service * 0x10));
+	}
+
+	static int serviceId(int service)
+	{
+		return (0x6d66 + service);
+	}
+
+	Carousel *addCarousel(int intervalMsecs);
+	void addEitSchedule(int service);
+	QByteArray eventText(int service, int event, int maximumSize);
+	void writeElementaryPacket(char *packet);
+
+	int serviceCount;
+	int eventCount;
+	QDate startDate;
+	double packetRate;
+	Random random;
+	QList<Carousel *> carousels;
+	QVector<unsigned char> continuityCounters;
+	qint64 packetIndex;
+	QByteArray siPackets; // pending si packets
+	int siPosition;
+	QVector<qint64> lastPcrPackets;
+	int nextService;
+	int nextStream;
+};
+
+Carousel *TsGenerator::addCarousel(int intervalMsecs)
+{
+	Carousel *carousel = new Carousel();
+	carousel->interval = qMax(qint64(1), qint64((intervalMsecs * packetRate) / 1000));
+	// spread the tables, so that they don't all start at the same time
+	carousel->nextPacket = (random.next() % carousel->interval);
+	carousels.append(carousel);
+	return carousel;
+}
+
+QByteArray TsGenerator::eventText(int service, int event, int maximumSize)
+{
+	static const char *const words[] = { "Nachrichten", "Wetter", "Sport", "Magazin",
+		"Dokumentation", "Spielfilm", "Serie", "Talkshow", "Kinder", "Kultur", "Reportage",
+		"Musik", "Natur", "Geschichte", "Wissenschaft", "Politik" };
+	QByteArray text;
+	int wordCount = (1 + ((service + (event * 7)) % 6) + ((maximumSize > 64) ? 24 : 0));
+
+	for (int i = 0; i < wordCount; ++i) {
+		QByteArray word = words[(service * 3 + event * 5 + i * 11) % 16];
+
+		if ((text.size() + word.size() + 1) > maximumSize) {
+			break;
+		}
+
+		if (!text.isEmpty()) {
+			text.append(' ');
+		}
+
+		text.append(word);
+	}
+
+	return text;
+}
+
+void TsGenerator::init()
+{
+	// pat
+
+	SectionBuilder pat(0x00, TransportStreamId, 0, 0, 0);
+	pat.appendShort(0x0000);
+	pat.appendShort(0xe000 | 0x0010); // nit pid
+
+	for (int service = 0; service < serviceCount; ++service) {
+		pat.appendShort(serviceId(service));
+		pat.appendShort(0xe000 | pmtPid(service));
+	}
+
+	QByteArray section = pat.finish();
+	addCarousel(100)->generator.appendSection(0x00, section.constData(), section.size());
+
+	// pmts (video, audio, subtitle)
+
+	for (int service = 0; service < serviceCount; ++service) {
+		int pid = pmtPid(service);
+		SectionBuilder pmt(0x02, serviceId(service), 0, 0, 0);
+		pmt.appendShort(0xe000 | (pid + 1)); // pcr pid
+		pmt.endLength(pmt.beginLength());
+
+		pmt.appendByte(0x02);
+		pmt.appendShort(0xe000 | (pid + 1));
+		pmt.endLength(pmt.beginLength());
+
+		pmt.appendByte(0x03);
+		pmt.appendShort(0xe000 | (pid + 2));
+		int position = pmt.beginLength();
+		pmt.appendData(descriptor(0x0a, QByteArray("deu\x00", 4)));
+		pmt.endLength(position);
+
+		pmt.appendByte(0x06);
+		pmt.appendShort(0xe000 | (pid + 3));
+		position = pmt.beginLength();
+		pmt.appendData(descriptor(0x59, QByteArray("deu\x10\x00\x01\x00\x01", 8)));
+		pmt.endLength(position);
+
+		section = pmt.finish();
+		addCarousel(100)->generator.appendSection(pid, section.constData(), section.size());
+	}
+
+	// nit actual (terrestrial delivery system and service list)
+
+	SectionBuilder nit(0x40, NetworkId, 0, 0, 0);
+	int position = nit.beginLength();
+	nit.appendData(descriptor(0x40, "Kaffeine Test Network"));
+	nit.endLength(position);
+	int loopPosition = nit.beginLength();
+	nit.appendShort(TransportStreamId);
+	nit.appendShort(OriginalNetworkId);
+	position = nit.beginLength();
+	// 578 MHz (10 Hz units), 8 MHz, 16-qam, fec 2/3, guard interval 1/4, 8k
+	nit.appendData(descriptor(0x5a,
+		QByteArray("\x03\x71\xf5\x40\x1f\x41\x1a\xff\xff\xff\xff", 11)));
+	QByteArray serviceList;
+
+	for (int service = 0; service < serviceCount; ++service) {
+		serviceList.append(char(serviceId(service) >> 8));
+		serviceList.append(char(serviceId(service)));
+		serviceList.append(char(0x01));
+
+		if (serviceList.size() > 252) {
+			break;
+		}
+	}
+
+	nit.appendData(descriptor(0x41, serviceList));
+	nit.endLength(position);
+	nit.endLength(loopPosition);
+	section = nit.finish();
+	addCarousel(10000)->generator.appendSection(0x10, section.constData(), section.size());
+
+	// sdt actual (may need multiple sections with many services)
+
+	QList<QByteArray> sdtEntries;
+
+	for (int service = 0; service < serviceCount; ++service) {
+		QByteArray name = "Kaffeine " + QByteArray::number(service + 1);
+		QByteArray content = char(0x01) + lengthPrefixed("Kaffeine") + lengthPrefixed(name);
+		QByteArray entry;
+		entry.append(char(serviceId(service) >> 8));
+		entry.append(char(serviceId(service)));
+		entry.append(char(0xfc));
+		QByteArray descriptors = descriptor(0x48, content);
+		entry.append(char(0x80 | (descriptors.size() >> 8)));
+		entry.append(char(descriptors.size()));
+		entry.append(descriptors);
+		sdtEntries.append(entry);
+	}
+
+	QList<QList<QByteArray> > sdtSections;
+	sdtSections.append(QList<QByteArray>());
+	int sectionSize = 0;
+
+	foreach (const QByteArray &entry, sdtEntries) {
+		if ((sectionSize + entry.size()) > 1000) {
+			sdtSections.append(QList<QByteArray>());
+			sectionSize = 0;
+		}
+
+		sdtSections.last().append(entry);
+		sectionSize += entry.size();
+	}
+
+	Carousel *sdtCarousel = addCarousel(2000);
+
+	for (int i = 0; i < sdtSections.size(); ++i) {
+		SectionBuilder sdt(0x42, TransportStreamId, 0, i, sdtSections.size() - 1);
+		sdt.appendShort(OriginalNetworkId);
+		sdt.appendByte(0xff);
+
+		foreach (const QByteArray &entry, sdtSections.at(i)) {
+			sdt.appendData(entry);
+		}
+
+		section = sdt.finish();
+		sdtCarousel->generator.appendSection(0x11, section.constData(), section.size());
+	}
+
+	// eit present / following and schedule
+
+	for (int service = 0; service < serviceCount; ++service) {
+		addEitSchedule(service);
+	}
+
+	lastPcrPackets.fill(-1, serviceCount);
+	nextService = 0;
+	nextStream = 0;
+}
+
+void TsGenerator::addEitSchedule(int service)
+{
+	// the schedule starts at midnight (utc)
+	int mjd = int(startDate.toJulianDay() - 2400001);
+	QList<QByteArray> events;
+	QList<int> startMinutes;
+	int minute = 0;
+
+	for (int event = 0; event < eventCount; ++event) {
+		int duration = (15 * (1 + ((event * 7 + service) % 8)));
+
+		if ((minute + duration) > (64 * 24 * 60)) {
+			// the schedule tables (0x50 - 0x5f) cover 64 days
+			qWarning() << "too many events for service" << service << "- using" << event;
+			break;
+		}
+
+		QByteArray descriptors = descriptor(0x4d, "deu" +
+			lengthPrefixed(eventText(service, event, 48)) +
+			lengthPrefixed(eventText(service, event + 1, 120)));
+
+		if ((event % 4) == 0) {
+			QByteArray details = eventText(service, event + 2, 240);
+			descriptors += descriptor(0x4e, char(0x00) + QByteArray("deu") + char(0x00) +
+				lengthPrefixed(details));
+		}
+
+		int day = (minute / (24 * 60));
+		int hour = ((minute / 60) % 24);
+		QByteArray entry;
+		entry.append(char((event + 1) >> 8));
+		entry.append(char(event + 1));
+		entry.append(char((mjd + day) >> 8));
+		entry.append(char(mjd + day));
+		entry.append(char(toBcd(hour)));
+		entry.append(char(toBcd(minute % 60)));
+		entry.append(char(0x00));
+		entry.append(char(toBcd(duration / 60)));
+		entry.append(char(toBcd(duration % 60)));
+		entry.append(char(0x00));
+		entry.append(char(0x80 | (descriptors.size() >> 8))); // running
+		entry.append(char(descriptors.size()));
+		entry.append(descriptors);
+		events.append(entry);
+		startMinutes.append(minute);
+		minute += duration;
+	}
+
+	// present / following (the first two events), repeated every two seconds
+
+	Carousel *carousel = addCarousel(2000);
+
+	for (int i = 0; (i < 2) && (i < events.size()); ++i) {
+		SectionBuilder eit(0x4e, serviceId(service), 0, i, 1);
+		eit.appendShort(TransportStreamId);
+		eit.appendShort(OriginalNetworkId);
+		eit.appendByte(1);
+		eit.appendByte(0x4e);
+		eit.appendData(events.at(i));
+		QByteArray section = eit.finish();
+		carousel->generator.appendSection(0x12, section.constData(), section.size());
+	}
+
+	// schedule: one table per four days, 32 segments per table, up to eight sections per
+	// segment; each table is repeated every ten seconds
+
+	QMap<int, QList<QByteArray> > tables; // section number + (table id << 8) -> events
+	int lastTableId = 0x50;
+
+	for (int i = 0; i < events.size(); ++i) {
+		int tableId = (0x50 + (startMinutes.at(i) / (4 * 24 * 60)));
+		int segment = ((startMinutes.at(i) % (4 * 24 * 60)) / (3 * 60));
+		int key = ((tableId << 8) | (segment * SectionsPerSegment));
+		int size = 0;
+
+		foreach (const QByteArray &event, tables.value(key)) {
+			size += event.size();
+		}
+
+		while (((size + events.at(i).size()) > MaximumEventsSize) &&
+		       (((key & 0xff) % SectionsPerSegment) != (SectionsPerSegment - 1))) {
+			// the section is full; continue with the next one of the segment
+			++key;
+			size = 0;
+
+			foreach (const QByteArray &event, tables.value(key)) {
+				size += event.size();
+			}
+		}
+
+		if ((size + events.at(i).size()) > MaximumEventsSize) {
+			qWarning() << "segment full for service" << service << "- dropping event" << i;
+			continue;
+		}
+
+		tables[key].append(events.at(i));
+		lastTableId = tableId;
+	}
+
+	carousel = NULL;
+	int currentTableId = -1;
+
+	for (QMap<int, QList<QByteArray> >::ConstIterator it = tables.constBegin();
+	     it != tables.constEnd(); ++it) {
+		int tableId = (it.key() >> 8);
+		int sectionNumber = (it.key() & 0xff);
+
+		if (tableId != currentTableId) {
+			carousel = addCarousel(10000);
+			currentTableId = tableId;
+		}
+
+		// the last section of the table and of the segment
+		int lastSectionNumber = ((tables.lowerBound((tableId + 1) << 8) - 1).key() & 0xff);
+		int segmentLastSectionNumber = sectionNumber;
+
+		while (tables.contains((tableId << 8) | (segmentLastSectionNumber + 1)) &&
+		       (((segmentLastSectionNumber + 1) % SectionsPerSegment) != 0)) {
+			++segmentLastSectionNumber;
+		}
+
+		SectionBuilder eit(tableId, serviceId(service), 0, sectionNumber, lastSectionNumber);
+		eit.appendShort(TransportStreamId);
+		eit.appendShort(OriginalNetworkId);
+		eit.appendByte(segmentLastSectionNumber);
+		eit.appendByte(lastTableId);
+
+		foreach (const QByteArray &event, it.value()) {
+			eit.appendData(event);
+		}
+
+		QByteArray section = eit.finish();
+		carousel->generator.appendSection(0x12, section.constData(), section.size());
+	}
+}
+
+// video (with pcr) and audio packets with pseudo-random payload
+
+void TsGenerator::writeElementaryPacket(char *packet)
+{
+	int service = nextService;
+	bool video = (nextStream < 7);
+
+	if (++nextStream == 8) {
+		nextStream = 0;
+		nextService = ((nextService + 1) % serviceCount);
+	}
+
+	int pid = (pmtPid(service) + (video ? 1 : 2));
+	packet[0] = 0x47;
+	packet[1] = char(pid >> 8);
+	packet[2] = char(pid);
+	packet[3] = 0x10;
+	int headerSize = 4;
+
+	// a pcr every 40 ms (in the first packet of a "frame"); every twelfth frame is a
+	// random access point
+
+	qint64 pcrInterval = qint64(packetRate / 25);
+
+	if (video && ((lastPcrPackets.at(service) < 0) ||
+	    ((packetIndex - lastPcrPackets.at(service)) >= pcrInterval))) {
+		qint64 frame = (packetIndex / qMax(qint64(1), pcrInterval));
+		qint64 pcr = qint64((packetIndex * 27000000.0) / packetRate);
+		qint64 pcrBase = (pcr / 300);
+		int pcrExtension = int(pcr % 300);
+		packet[1] = char(packet[1] | 0x40);
+		packet[3] = 0x30;
+		packet[4] = 7;
+		packet[5] = char(0x10 | (((frame % 12) == 0) ? 0x40 : 0x00));
+		packet[6] = char(pcrBase >> 25);
+		packet[7] = char(pcrBase >> 17);
+		packet[8] = char(pcrBase >> 9);
+		packet[9] = char(pcrBase >> 1);
+		packet[10] = char(((pcrBase & 0x01) << 7) | 0x7e | (pcrExtension >> 8));
+		packet[11] = char(pcrExtension);
+		headerSize = 12;
+
+		// pes header (without pts)
+		const char pesHeader[] = { 0x00, 0x00, 0x01, char(0xe0), 0x00, 0x00, char(0x80),
+			0x00, 0x00 };
+		memcpy(packet + headerSize, pesHeader, sizeof(pesHeader));
+		headerSize += sizeof(pesHeader);
+		lastPcrPackets[service] = packetIndex;
+	}
+
+	for (int i = headerSize; i < 188; i += 4) {
+		quint32 value = random.next();
+		memcpy(packet + i, &value, qMin(4, 188 - i));
+	}
+}
+
+QByteArray TsGenerator::generate(qint64 packetCount, double ccErrorRate, double teiRate)
+{
+	QByteArray result(int(packetCount * 188), Qt::Uninitialized);
+	char *packet = result.data();
+
+	for (qint64 i = 0; i < packetCount; ++i) {
+		foreach (Carousel *carousel, carousels) {
+			if (carousel->nextPacket <= packetIndex) {
+				if (siPosition > 0) {
+					siPackets.remove(0, siPosition);
+					siPosition = 0;
+				}
+
+				siPackets.append(carousel->generator.generatePackets());
+				carousel->nextPacket += carousel->interval;
+			}
+		}
+
+		// si data gets at most every second packet
+
+		if ((siPosition < siPackets.size()) && ((packetIndex % 2) == 0)) {
+			memcpy(packet, siPackets.constData() + siPosition, 188);
+			siPosition += 188;
+		} else {
+			writeElementaryPacket(packet);
+		}
+
+		// continuity counters (the generators count per table, not per pid)
+
+		int pid = (((quint8(packet[1]) << 8) | quint8(packet[2])) & 0x1fff);
+
+		if (random.chance(ccErrorRate)) {
+			// a lost packet
+			continuityCounters[pid] = ((continuityCounters.at(pid) + 1) & 0x0f);
+		}
+
+		packet[3] = char((packet[3] & 0xf0) | continuityCounters.at(pid));
+		continuityCounters[pid] = ((continuityCounters.at(pid) + 1) & 0x0f);
+
+		if (random.chance(teiRate)) {
+			packet[1] = char(packet[1] | 0x80);
+		}
+
+		packet += 188;
+		++packetIndex;
+	}
+
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication application(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Generates a synthetic multi-program transport stream "
+		"(pat, pmt, nit, sdt, eit present / following and schedule, video and audio).");
+	parser.addHelpOption();
+	parser.addPositionalArgument("output", "The transport stream file to write.");
+	QCommandLineOption servicesOption("services", "Number of services (default 8).",
+		"count", "8");
+	QCommandLineOption bitrateOption("bitrate", "Bitrate in kbit/s (default 24000).",
+		"kbit/s", "24000");
+	QCommandLineOption durationOption("duration", "Duration in seconds (default 60).",
+		"seconds", "60");
+	QCommandLineOption eventsOption("events",
+		"Number of eit schedule events per service (default 500).", "count", "500");
+	QCommandLineOption ccErrorsOption("cc-error-rate",
+		"Probability of a continuity counter error per packet (default 0).", "rate", "0");
+	QCommandLineOption teiOption("tei-rate",
+		"Probability of a transport error indicator per packet (default 0).", "rate", "0");
+	QCommandLineOption dateOption("date",
+		"Start date of the eit schedule (yyyy-MM-dd, default today).", "date");
+	QCommandLineOption seedOption("seed", "Seed for the pseudo-random data (default 1).",
+		"value", "1");
+	parser.addOption(servicesOption);
+	parser.addOption(bitrateOption);
+	parser.addOption(durationOption);
+	parser.addOption(eventsOption);
+	parser.addOption(ccErrorsOption);
+	parser.addOption(teiOption);
+	parser.addOption(dateOption);
+	parser.addOption(seedOption);
+	parser.process(application);
+
+	if (parser.positionalArguments().size() != 1) {
+		parser.showHelp(1);
+	}
+
+	int serviceCount = parser.value(servicesOption).toInt();
+	int bitrate = parser.value(bitrateOption).toInt();
+	int duration = parser.value(durationOption).toInt();
+	int eventCount = parser.value(eventsOption).toInt();
+	double ccErrorRate = parser.value(ccErrorsOption).toDouble();
+	double teiRate = parser.value(teiOption).toDouble();
+	quint32 seed = parser.value(seedOption).toUInt();
+	QDate startDate = QDate::currentDate();
+
+	if (parser.isSet(dateOption)) {
+		startDate = QDate::fromString(parser.value(dateOption), Qt::ISODate);
+	}
+
+	if ((serviceCount < 1) || (serviceCount > 200) || (bitrate < 1000) || (duration < 1) ||
+	    (eventCount < 0) || !startDate.isValid() || (seed == 0)) {
+		qCritical() << "invalid parameters";
+		return 1;
+	}
+
+	QFile file(parser.positionalArguments().at(0));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCritical() << "can't open file" << file.fileName();
+		return 1;
+	}
+
+	TsGenerator generator(serviceCount, bitrate, eventCount, startDate, seed);
+	generator.init();
+	qint64 packetCount = ((qint64(bitrate) * 1000 * duration) / (188 * 8));
+
+	while (packetCount > 0) {
+		qint64 count = qMin(packetCount, qint64(10000));
+
+		if (file.write(generator.generate(count, ccErrorRate, teiRate)) != (count * 188)) {
+			qCritical() << "can't write file" << file.fileName();
+			return 1;
+		}
+
+		packetCount -= count;
+	}
+
+	return 0;
+}
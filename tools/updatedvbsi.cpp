@@ -202,7 +202,9 @@ void SiXmlParser::parseEntry(QDomNode node, Type type, QTextStream &headerStream
 
 	QString entryName = node.nodeName();
 	QString initFunctionName = QString(entryName).replace(QRegExp("^Dvb|^Atsc"), "init");
+	QString logPrefix = (entryName + "::" + ((type == Descriptor) ? entryName : initFunctionName) + ": ");
 	bool ignoreFirstNewLine = false;
+	QString entryLengthCalculation; // empty for fixed length entries
 
 	switch (type) {
 	case Descriptor:
@@ -210,7 +212,7 @@ void SiXmlParser::parseEntry(QDomNode node, Type type, QTextStream &headerStream
 		cppStream << entryName << "::" << entryName << "(const DvbDescriptor &descriptor) : DvbDescriptor(descriptor)\n";
 		cppStream << "{\n";
 		cppStream << "\tif (getLength() < " << (minBits / 8) << ") {\n";
-		cppStream << "\t\tkDebug() << \"invalid descriptor\";\n";
+		cppStream << "\t\tLog(\"" << logPrefix << "invalid descriptor\");\n";
 		cppStream << "\t\tinitSectionData();\n";
 		cppStream << "\t\treturn;\n";
 		cppStream << "\t}\n";
@@ -222,7 +224,7 @@ void SiXmlParser::parseEntry(QDomNode node, Type type, QTextStream &headerStream
 		cppStream << "{\n";
 		cppStream << "\tif (size < " << (minBits / 8) << ") {\n";
 		cppStream << "\t\tif (size != 0) {\n";
-		cppStream << "\t\t\tkDebug() << \"invalid entry\";\n";
+		cppStream << "\t\t\tLog(\"" << logPrefix << "invalid entry\");\n";
 		cppStream << "\t\t}\n";
 		cppStream << "\n";
 		cppStream << "\t\tinitSectionData();\n";
@@ -244,21 +246,23 @@ void SiXmlParser::parseEntry(QDomNode node, Type type, QTextStream &headerStream
 				return;
 			}
 
-			QString entryLengthCalculation = element.toString();
+			entryLengthCalculation = element.toString();
 
 			while (true) {
 				int oldSize = entryLengthCalculation.size();
-				entryLengthCalculation.replace(QRegExp("at\\(([0-9]*)\\)"), "static_cast<unsigned char>(data[\\1])");
+				entryLengthCalculation.replace(QRegExp("at\\(([0-9]*)\\)"), "quint8(data[\\1])");
 
 				if (entryLengthCalculation.size() == oldSize) {
 					break;
 				}
 			}
 
-			cppStream << "\tint entryLength = ((" << entryLengthCalculation << ") + " << ((element.bitIndex + element.bits) / 8) << ");\n";
+			entryLengthCalculation = ("((" + entryLengthCalculation + ") + " +
+				QString::number((element.bitIndex + element.bits) / 8) + ")");
+			cppStream << "\tint entryLength = " << entryLengthCalculation << ";\n";
 			cppStream << "\n";
 			cppStream << "\tif (entryLength > size) {\n";
-			cppStream << "\t\tkDebug() << \"adjusting length\";\n";
+			cppStream << "\t\tLog(\"" << logPrefix << "adjusting length\");\n";
 			cppStream << "\t\tentryLength = size;\n";
 			cppStream << "\t}\n";
 			cppStream << "\n";
@@ -317,11 +321,11 @@ void SiXmlParser::parseEntry(QDomNode node, Type type, QTextStream &headerStream
 
 		if (element.offsetString.isEmpty()) {
 			cppStream << "\tif (" << element.name << "Length > (getLength() - " << (minBits / 8) << ")) {\n";
-			cppStream << "\t\tkDebug() << \"adjusting length\";\n";
+			cppStream << "\t\tLog(\"" << logPrefix << "adjusting length\");\n";
 			cppStream << "\t\t" << element.name << "Length = (getLength() - " << (minBits / 8) << ");\n";
 		} else {
 			cppStream << "\tif (" << element.name << "Length > (getLength() - (" << (minBits / 8) << element.offsetString << "))) {\n";
-			cppStream << "\t\tkDebug() << \"adjusting length\";\n";
+			cppStream << "\t\tLog(\"" << logPrefix << "adjusting length\");\n";
 			cppStream << "\t\t" << element.name << "Length = (getLength() - (" << (minBits / 8) << element.offsetString << "));\n";
 		}
 
@@ -378,9 +382,29 @@ void SiXmlParser::parseEntry(QDomNode node, Type type, QTextStream &headerStream
 
 	if (type == Entry) {
 		headerStream << "\n";
+		headerStream << "\t// the common case (a complete entry) is handled inline\n";
 		headerStream << "\tvoid advance()\n";
 		headerStream << "\t{\n";
-		headerStream << "\t\t" << initFunctionName << "(getData() + getLength(), getSize() - getLength());\n";
+		headerStream << "\t\tconst char *data = (getData() + getLength());\n";
+		headerStream << "\t\tint size = (getSize() - getLength());\n";
+		headerStream << "\n";
+		headerStream << "\t\tif (size >= " << (minBits / 8) << ") {\n";
+
+		if (!entryLengthCalculation.isEmpty()) {
+			headerStream << "\t\t\tint entryLength = " << entryLengthCalculation << ";\n";
+			headerStream << "\n";
+			headerStream << "\t\t\tif (entryLength <= size) {\n";
+			headerStream << "\t\t\t\tinitSectionData(data, entryLength, size);\n";
+			headerStream << "\t\t\t\treturn;\n";
+			headerStream << "\t\t\t}\n";
+		} else {
+			headerStream << "\t\t\tinitSectionData(data, " << (minBits / 8) << ", size);\n";
+			headerStream << "\t\t\treturn;\n";
+		}
+
+		headerStream << "\t\t}\n";
+		headerStream << "\n";
+		headerStream << "\t\t" << initFunctionName << "(data, size);\n";
 		headerStream << "\t}\n";
 	}
 